@@ -1,27 +1,85 @@
 #include "bench.h"
 
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "bitboard.h"
 #include "common.h"
+#include "hash.h"
+#include "movegen.h"
 #include "search.h"
 #include "threads.h"
 #include "uci.h"
 
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// scaling fails the false sharing check when cache misses per node grow past this multiple of one thread's
+	constexpr auto false_sharing_miss_ratio = 2.0;
+
+	// a user space cache miss counter for the calling thread, -1 when the kernel or cpu does not provide one
+	int open_miss_counter()
+	{
+#if defined(__linux__)
+		perf_event_attr attr{};
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof attr;
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+		return -1;
+#endif
+	}
+
+	// adds up and closes the counters of all search threads, false when any of them could not be opened
+	bool read_miss_counters(const std::vector<int>& fds, uint64_t& misses)
+	{
+		auto valid = true;
+		misses = 0;
+
+		for (const auto fd : fds)
+		{
+#if defined(__linux__)
+			uint64_t count = 0;
+			valid = valid && fd >= 0 && read(fd, &count, sizeof count) == sizeof count;
+			misses += count;
+			if (fd >= 0)
+				close(fd);
+#else
+			valid = valid && fd >= 0;
+#endif
+		}
+		return valid;
+	}
+}
+
 void UCI::bench(bit_board& board, state_list& state) const
 {
 	static FILE* bench_log;
 	static char file_name[256];
 	char buf[256];
 
-	uint64_t nodes = 0;
+	uint64_t nodes = 0, tt_evals = 0;
+	search_stats stats;
+	time_point clear_time = 0;
 	auto start_time = now();
 
 	for (auto& bench_position : bench_positions)
 	{
+		const auto clear_start = now();
 		Search::clear();
+		clear_time += now() - clear_start;
 		std::string test_fen = "fen ";
 		test_fen += bench_position;
 		std::istringstream is(test_fen);
@@ -31,32 +89,30 @@ void UCI::bench(bit_board& board, state_list& state) const
 		go(board, iss, state);
 		threads.main()->wait_for_search_stop();
 		nodes += threads.nodes_searched();
+		tt_evals += threads.tt_evals();
+		stats += threads.stats();
 	}
 
 	auto elapsed_time = static_cast<double>(now() + 1 - start_time) / 1000;
 	auto nps = static_cast<double>(nodes) / elapsed_time;
 
-	Sleep(500);
-
-	sync_indent;
-	std::cout << "Nodes: " << nodes << std::endl;
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
 	std::ostringstream ss;
+	ss << std::fixed;
+	ss << "Pages: " << tt.page_mode_str() << std::endl;
+	ss << "Nodes: " << nodes << std::endl;
+	ss << "Evals: " << tt_evals << " reused from TT" << std::endl;
+	ss << "Time : " << std::setprecision(2) << elapsed_time << " secs" << std::endl;
+	ss << "NPS  : " << std::setprecision(0) << nps << std::endl;
+	ss << "TTD  : " << std::setprecision(2) << elapsed_time / 64 << " secs" << std::endl;
+	ss << "Clear: " << std::setprecision(3) << static_cast<double>(clear_time) / 1000 << " secs (" << threads.size() << " threads)" << std::endl;
 
-	ss.precision(2);
-	ss << "Time : " << std::fixed << elapsed_time << " secs" << std::endl;
-	std::cout << ss.str();
-	ss.str(std::string());
-
-	ss.precision(0);
-	ss << "NPS  : " << std::fixed << nps << std::endl;
-	std::cout << ss.str();
-	ss.str(std::string());
+	if (search_stats_enabled)
+		ss << stats.report();
 
-	ss.precision(2);
-	ss << "TTD  : " << std::fixed << elapsed_time / 64 << " secs" << std::endl;
-	std::cout << ss.str();
-	ss.str(std::string());
+	// one locked write, so lines from the cluster sender thread cannot land inside the report
+	sync_out << std::endl << ss.str() << sync_endl;
 
 	auto now = time(nullptr);
 	strftime(buf, 32, "%b-%d_%H-%M", localtime(&now));
@@ -66,11 +122,299 @@ void UCI::bench(bit_board& board, state_list& state) const
 	bench_log = fopen(file_name, "wt");
 
 	fprintf(bench_log, "%s %s %s\n", engine, version, platform);
+	fprintf(bench_log, "Pages: %s\n", tt.page_mode_str());
 	fprintf(bench_log, "Nodes: %lld\n", nodes);
+	fprintf(bench_log, "Evals: %lld reused from TT\n", tt_evals);
 	fprintf(bench_log, "Time : %.2f secs\n", elapsed_time);
 	fprintf(bench_log, "NPS  : %.0f\n", nps);
 	fprintf(bench_log, "TTD  : %.2f secs\n", elapsed_time / 64);
+	fprintf(bench_log, "Clear: %.3f secs (%zu threads)\n", static_cast<double>(clear_time) / 1000, threads.size());
+	if (search_stats_enabled)
+		fputs(stats.report().c_str(), bench_log);
 	fclose(bench_log);
 
 	new_game(board, state);
 }
+
+void UCI::tt_bench(bit_board& board, state_list& state, const int depth) const
+{
+	const auto thread_count = threads.size();
+	threads.number_of_threads(1);
+	tt.track_stats(true);
+
+	for (auto& bench_position : bench_positions)
+	{
+		Search::clear();
+		std::string test_fen = "fen ";
+		test_fen += bench_position;
+		std::istringstream is(test_fen);
+		update_position(board, is, state);
+		std::istringstream iss("depth " + std::to_string(depth));
+		go(board, iss, state);
+		threads.main()->wait_for_search_stop();
+	}
+
+	const auto stats = tt.stats();
+	tt.track_stats(false);
+	threads.number_of_threads(thread_count);
+
+	const auto probes = static_cast<double>(std::max<uint64_t>(stats.probes, 1));
+	std::ostringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+	ss << "Probes    : " << stats.probes << std::endl;
+	ss << "Hit rate  : " << std::setw(10) << 100 * stats.hits / probes << " %" << std::endl;
+	ss << "Cutoffs   : " << std::setw(10) << 100 * stats.cutoffs / probes << " %" << std::endl;
+
+	// not a second run: the same probes checked against only the top 16 bits of the stored key
+	ss << "16-bit key check on the same probes:" << std::endl;
+	ss << "Hit rate  : " << std::setw(10) << 100 * (stats.hits + stats.key16_collisions) / probes << " %" << std::endl;
+	ss << "False hits: " << std::setw(10) << 100 * stats.key16_collisions / probes << " %" << std::endl;
+	sync_out << std::endl << ss.str() << sync_endl;
+
+	new_game(board, state);
+}
+
+void UCI::scaling(bit_board& board, state_list& state, const int max_threads) const
+{
+	const auto thread_count = threads.size();
+	double base_nps = 0, base_misses = 0;
+	auto counted = true;
+	auto failed_at = 0;
+	std::ostringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+
+	for (auto n = 1; n <= max_threads; ++n)
+	{
+		threads.number_of_threads(n);
+		uint64_t nodes = 0;
+
+		// each search thread opens the counter for itself, so misses are counted on whichever cpu it runs
+		std::vector<int> fds(threads.size(), -1);
+		for (size_t i = 0; i < threads.size(); ++i)
+			threads[i]->execute([&fd = fds[i]] { fd = open_miss_counter(); });
+		for (auto* th : threads)
+			th->wait_for_search_stop();
+
+		const auto start_time = now();
+
+		for (auto& bench_position : bench_positions)
+		{
+			Search::clear();
+			std::string test_fen = "fen ";
+			test_fen += bench_position;
+			std::istringstream is(test_fen);
+			update_position(board, is, state);
+			std::istringstream iss("depth 12");
+			go(board, iss, state);
+			threads.main()->wait_for_search_stop();
+			nodes += threads.nodes_searched();
+		}
+
+		const auto nps = static_cast<double>(nodes) * 1000 / static_cast<double>(now() + 1 - start_time);
+		uint64_t misses;
+		counted = read_miss_counters(fds, misses) && counted;
+		const auto misses_per_knode = static_cast<double>(misses) * 1000 / static_cast<double>(std::max<uint64_t>(nodes, 1));
+
+		if (n == 1)
+		{
+			base_nps = nps;
+			base_misses = misses_per_knode;
+		}
+		else if (counted && !failed_at && misses_per_knode > false_sharing_miss_ratio * base_misses)
+			failed_at = n;
+
+		ss << "Threads: " << std::setw(3) << n << "  NPS: " << std::setw(10) << std::setprecision(0) << nps
+			<< "  Speedup: " << std::setprecision(2) << nps / base_nps;
+		if (counted)
+			ss << "  Misses/kN: " << std::setw(8) << misses_per_knode;
+		ss << std::endl;
+	}
+
+	// false sharing between threads shows up as cache misses per node that grow with the thread count
+	if (!counted)
+		ss << "False sharing check: skipped, no cache miss counter" << std::endl;
+	else if (failed_at)
+		ss << "False sharing check: FAILED at " << failed_at << " threads, more than " << false_sharing_miss_ratio
+			<< " times the misses per node of one thread" << std::endl;
+	else
+		ss << "False sharing check: passed" << std::endl;
+
+	threads.number_of_threads(thread_count);
+	sync_out << std::endl << ss.str() << sync_endl;
+	new_game(board, state);
+}
+
+// time to solution: the smallest of a doubling series of search times after which the chosen move is the solution
+int UCI::solve_suite(bit_board& board, state_list& state, const int max_time, time_point& total) const
+{
+	auto solved = 0;
+	total = 0;
+
+	for (auto& position : tactical_positions)
+	{
+		for (auto ms = 100; ms <= max_time; ms *= 2)
+		{
+			Search::clear();
+			std::istringstream is(std::string("fen ") + position[0]);
+			update_position(board, is, state);
+			std::istringstream iss("infinite");
+			go(board, iss, state);
+			std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+			threads.stop = true;
+			threads.main()->wait_for_search_stop();
+
+			if (Uci::move_to_str(threads.main()->best_move) == position[1])
+			{
+				++solved;
+				total += ms;
+				break;
+			}
+		}
+	}
+	return solved;
+}
+
+// fixed depth, so search changes can be compared by solutions and nodes independent of speed
+void UCI::solve_depth(bit_board& board, state_list& state, const int depth) const
+{
+	auto solved = 0;
+	uint64_t nodes = 0;
+	const auto start_time = now();
+
+	for (auto& position : tactical_positions)
+	{
+		Search::clear();
+		std::istringstream is(std::string("fen ") + position[0]);
+		update_position(board, is, state);
+		std::istringstream iss("depth " + std::to_string(depth));
+		go(board, iss, state);
+		threads.main()->wait_for_search_stop();
+		nodes += threads.nodes_searched();
+
+		if (Uci::move_to_str(threads.main()->best_move) == position[1])
+			++solved;
+	}
+
+	std::ostringstream ss;
+	ss.precision(2);
+	ss << "Depth: " << depth << "  Solved: " << solved << "/" << std::size(tactical_positions) << "  Nodes: " << nodes
+		<< "  Time: " << std::fixed << static_cast<double>(now() - start_time) / 1000 << " secs" << std::endl;
+	sync_out << std::endl << ss.str() << sync_endl;
+	new_game(board, state);
+}
+
+time_point UCI::time_to_depth(bit_board& board, state_list& state, const int depth) const
+{
+	const auto start_time = now();
+
+	for (auto& bench_position : bench_positions)
+	{
+		Search::clear();
+		std::istringstream is(std::string("fen ") + bench_position);
+		update_position(board, is, state);
+		std::istringstream iss("depth " + std::to_string(depth));
+		go(board, iss, state);
+		threads.main()->wait_for_search_stop();
+	}
+	return now() - start_time;
+}
+
+void UCI::solve(bit_board& board, state_list& state, const int max_threads, const int max_time) const
+{
+	const auto thread_count = threads.size();
+	std::ostringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+
+	for (auto n = 1; n <= max_threads; n *= 2)
+	{
+		threads.number_of_threads(n);
+		time_point total;
+		const auto solved = solve_suite(board, state, max_time, total);
+
+		ss << "Threads: " << std::setw(3) << n << "  Solved: " << solved << "/" << std::size(tactical_positions)
+			<< "  Time: " << static_cast<double>(total) / 1000 << " secs" << std::endl;
+	}
+
+	threads.number_of_threads(thread_count);
+	sync_out << std::endl << ss.str() << sync_endl;
+	new_game(board, state);
+}
+
+// plain lazy smp against abdada deferral at the same thread count
+void UCI::smp_bench(bit_board& board, state_list& state, const int thread_count, const int depth) const
+{
+	const auto old_thread_count = threads.size();
+	const auto old_abdada = threads.abdada;
+	threads.number_of_threads(thread_count);
+	std::ostringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+
+	for (const auto abdada : {false, true})
+	{
+		threads.abdada = abdada;
+		const auto ttd = time_to_depth(board, state, depth);
+		time_point total;
+		const auto solved = solve_suite(board, state, 3200, total);
+
+		ss << (abdada ? "ABDADA   " : "Lazy SMP ") << " TTD: " << static_cast<double>(ttd) / 1000 << " secs  Solved: "
+			<< solved << "/" << std::size(tactical_positions) << "  Time: " << static_cast<double>(total) / 1000 << " secs" << std::endl;
+	}
+
+	threads.abdada = old_abdada;
+	threads.number_of_threads(old_thread_count);
+	sync_out << std::endl << "Threads: " << thread_count << "  Depth: " << depth << std::endl << ss.str() << sync_endl;
+	new_game(board, state);
+}
+
+void UCI::board_bench() const
+{
+	constexpr auto copies = 1000000;
+	constexpr auto passes = 20000;
+
+	std::vector<bit_board> boards(2);
+	uint64_t sink = 0, moves = 0;
+
+	auto start = now();
+	for (auto i = 0; i < copies; ++i)
+	{
+		boards[i & 1] = boards[~i & 1];
+		sink += boards[i & 1].full_squares;
+	}
+	const auto copy_time = now() - start;
+
+	time_point move_time = 0;
+	for (auto& bench_position : bench_positions)
+	{
+		const std::string fen = std::string(bench_position) + " 0 1";
+		auto& board = boards[0];
+		state_info root{};
+		board.reset_board(&fen, threads.main(), &root);
+		const move_list<legal> list(board);
+		state_info si{};
+		const auto color = board.stm();
+
+		start = now();
+		for (auto i = 0; i < passes; ++i)
+			for (const auto& m : list)
+			{
+				board.make_move(m, si, color);
+				sink += si.key;
+				board.unmake_move(m, color);
+			}
+		move_time += now() - start;
+		moves += static_cast<uint64_t>(passes) * list.size();
+	}
+
+	std::ostringstream ss;
+	ss.precision(2);
+	ss << std::fixed;
+	ss << "Size : " << sizeof(bit_board) << " bytes" << std::endl;
+	ss << "Copy : " << static_cast<double>(copy_time) * 1000000 / copies << " ns" << std::endl;
+	ss << "Make : " << static_cast<double>(move_time) * 1000000 / static_cast<double>(moves) << " ns (make + unmake)" << std::endl;
+	ss << "Check: " << (sink & 0xFFFF) << std::endl;
+	sync_out << std::endl << ss.str() << sync_endl;
+}
@@ -54,11 +54,6 @@ inline uint64_t attacks_bb(const int pt, const int sq, const uint64_t occ)
 
 void bit_board::init_board()
 {
-	std::memcpy(zobrist::zob_array, zobrist.z_array, sizeof zobrist.z_array);
-	std::memcpy(zobrist::en_passant, zobrist.z_en_passant, sizeof zobrist.z_en_passant);
-	std::memcpy(zobrist::castling, zobrist.z_castle, sizeof zobrist.z_castle);
-	zobrist::color = zobrist.z_black_move;
-
 	for (auto i = 0; i < 64; ++i)
 	{
 		uint64_t moves;
@@ -251,7 +246,7 @@ void bit_board::set_state(state_info* si, thread* th)
 	si->material_key = 0LL;
 	si->pawn_key = 0LL;
 	si->captured_piece = 0;
-	si->key = zobrist.get_zobrist_hash(*this);
+	si->key = zobrist_hash::get_zobrist_hash(*this);
 	si->checkers = attackers_to(king_square(stm()), full_squares) & pieces(!stm());
 
 	this_thread_ = th;
@@ -274,13 +269,13 @@ void bit_board::set_state(state_info* si, thread* th)
 
 				while (pawn_board)
 				{
-					si->pawn_key ^= zobrist.z_array[c][pawn][pop_lsb(&pawn_board)];
+					si->pawn_key ^= zobrist::zob_array[c][pawn][pop_lsb(&pawn_board)];
 				}
 			}
 
 			for (auto count = 0; count <= piece_count[c][pt]; ++count)
 			{
-				si->material_key ^= zobrist.z_array[c][pt][count];
+				si->material_key ^= zobrist::zob_array[c][pt][count];
 			}
 		}
 	}
@@ -508,7 +503,7 @@ void bit_board::set_castling_rights(const int color, const int rfrom)
 
 void bit_board::make_move(const Move& m, state_info& new_st, const int color)
 {
-	this_thread_->nodes.fetch_add(1, std::memory_order_relaxed);
+	this_thread_->count_node();
 	const int them = !color;
 	const auto to = to_sq(m);
 	const auto from = from_sq(m);
@@ -583,7 +578,7 @@ void bit_board::make_move(const Move& m, state_info& new_st, const int color)
 			st_->rule50;
 		}
 
-		st_->pawn_key ^= zobrist.z_array[color][pawn][to] ^ zobrist.z_array[color][pawn][from];
+		st_->pawn_key ^= zobrist::zob_array[color][pawn][to] ^ zobrist::zob_array[color][pawn][from];
 	}
 	else if (move_type(m) == castle)
 	{
@@ -8,7 +8,6 @@
 
 extern attacks slider_attacks;
 
-class zobrist_hash;
 class move_gen;
 class thread;
 
@@ -52,7 +51,6 @@ class bit_board
 public:
 	void init_board();
 
-	zobrist_hash zobrist{};
 	[[nodiscard]] uint64_t next_key(Move m) const;
 
 	void reset_board(const std::string* fen, thread* th, state_info* si);
@@ -142,7 +140,7 @@ public:
 
 	void set_castling_rights(int color, int rfrom);
 	int castling_rights_masks[sq_all]{};
-	uint64_t castling_path[castling_rights]{};
+	uint64_t castling_path[::castling_rights]{};
 	[[nodiscard]] int castling_rights() const;
 	[[nodiscard]] int can_castle(int color) const;
 	[[nodiscard]] bool castling_impeded(int castling_rights) const;
@@ -151,6 +149,7 @@ public:
 	[[nodiscard]] int ep_square() const;
 
 	[[nodiscard]] thread* this_thread() const;
+	[[nodiscard]] const state_info* state() const;
 
 private:
 	state_info* st_ = nullptr;
@@ -271,6 +270,11 @@ inline thread* bit_board::this_thread() const
 	return this_thread_;
 }
 
+inline const state_info* bit_board::state() const
+{
+	return st_;
+}
+
 inline int bit_board::king_square(const int color) const
 {
 	return piece_loc[color][king][0];
@@ -1,33 +1,48 @@
 #pragma once
+#include <cstdint>
+#ifdef _MSC_VER
 #include <intrin.h>
+#endif
 
-inline int lsb(const unsigned long long b)
+inline int lsb(const uint64_t b)
 {
+#ifdef _MSC_VER
 	unsigned long idx;
 	_BitScanForward64(&idx, b);
 	return static_cast<int>(idx);
+#else
+	return __builtin_ctzll(b);
+#endif
 }
 
-inline int msb(const unsigned long long b)
+inline int msb(const uint64_t b)
 {
+#ifdef _MSC_VER
 	unsigned long idx;
 	_BitScanReverse64(&idx, b);
 	return static_cast<int>(idx);
+#else
+	return 63 ^ __builtin_clzll(b);
+#endif
 }
 
-inline int pop_lsb(unsigned long long* b)
+inline int pop_lsb(uint64_t* b)
 {
 	const auto s = lsb(*b);
 	*b &= *b - 1;
 	return s;
 }
 
-inline int popcnt(const unsigned long long b)
+inline int popcnt(const uint64_t b)
 {
+#ifdef _MSC_VER
 	return static_cast<int>(_mm_popcnt_u64(b));
+#else
+	return __builtin_popcountll(b);
+#endif
 }
 
-inline bool more_than_one(const unsigned long long b)
+inline bool more_than_one(const uint64_t b)
 {
 	return b & b - 1;
 }
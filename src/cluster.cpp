@@ -0,0 +1,485 @@
+#include "cluster.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "bitboard.h"
+#include "hash.h"
+#include "threads.h"
+#include "uci.h"
+
+#if defined(__linux__)
+#include <csignal>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
+
+cluster_pool cluster;
+
+cluster_pool::~cluster_pool()
+{
+	close();
+}
+
+#if defined(__linux__)
+
+// there is no authentication, so anything that can reach the port can read the game and write the tt.
+// the address is loopback unless the Cluster Address option names another interface
+bool cluster_pool::listen(const std::string& address, const int port)
+{
+	if (listen_fd_ >= 0 || is_worker_)
+		return false;
+
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(static_cast<uint16_t>(port));
+	if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+		return false;
+
+	const auto fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		return false;
+
+	constexpr auto on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+
+	if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0 || ::listen(fd, 16) < 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	signal(SIGPIPE, SIG_IGN);
+	listen_fd_ = fd;
+	acceptor_ = std::thread(&cluster_pool::accept_loop, this);
+	start_sender();
+	return true;
+}
+
+bool cluster_pool::join(const std::string& host, const int port)
+{
+	if (listen_fd_ >= 0 || is_worker_)
+		return false;
+
+	addrinfo hints{}, *result = nullptr;
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) || !result)
+		return false;
+
+	const auto fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	const auto connected = fd >= 0 && connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+	freeaddrinfo(result);
+
+	if (!connected)
+	{
+		if (fd >= 0)
+			::close(fd);
+		return false;
+	}
+
+	constexpr auto on = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+
+	// from here on the uci loop talks to the master instead of the terminal
+	signal(SIGPIPE, SIG_IGN);
+	dup2(fd, STDIN_FILENO);
+	dup2(fd, STDOUT_FILENO);
+	::close(fd);
+	std::cin.clear();
+
+	is_worker_ = true;
+	active_ = true;
+	start_sender();
+	return true;
+}
+
+void cluster_pool::close()
+{
+	stop_sender();
+
+	if (listen_fd_ >= 0)
+	{
+		shutdown(listen_fd_, SHUT_RDWR);
+		::close(listen_fd_);
+		listen_fd_ = -1;
+	}
+
+	if (acceptor_.joinable())
+		acceptor_.join();
+
+	// readers may be waiting on workers_mutex_ to forward a tt line, so they are joined outside it
+	std::vector<std::unique_ptr<worker>> workers;
+	{
+		std::lock_guard<std::mutex> lock(workers_mutex_);
+		workers.swap(workers_);
+	}
+
+	for (auto& w : workers)
+	{
+		shutdown(w->fd, SHUT_RDWR);
+		if (w->reader.joinable())
+			w->reader.join();
+		::close(w->fd);
+	}
+	active_ = false;
+}
+
+void cluster_pool::accept_loop()
+{
+	int fd;
+	while ((fd = accept(listen_fd_, nullptr, nullptr)) >= 0)
+	{
+		constexpr auto on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+
+		auto w = std::make_unique<worker>();
+		w->fd = fd;
+		w->reader = std::thread(&cluster_pool::read_loop, this, w.get());
+
+		std::lock_guard<std::mutex> lock(workers_mutex_);
+		workers_.push_back(std::move(w));
+		active_ = true;
+		sync_out << "info string cluster worker " << workers_.size() << " connected" << sync_endl;
+	}
+}
+
+void cluster_pool::read_loop(worker* w)
+{
+	std::string buffer;
+	char chunk[4096];
+	ssize_t n;
+
+	while ((n = recv(w->fd, chunk, sizeof chunk, 0)) > 0)
+	{
+		buffer.append(chunk, static_cast<size_t>(n));
+
+		size_t end;
+		while ((end = buffer.find('\n')) != std::string::npos)
+		{
+			std::istringstream is(buffer.substr(0, end));
+			buffer.erase(0, end + 1);
+
+			std::string token;
+			is >> token;
+
+			if (token == "info")
+			{
+				// only the per-iteration lines carry a depth, info string lines are ignored. an aspiration
+				// fail line is a bound from an unfinished iteration, so it is never kept as the result
+				int depth = 0, score = 0;
+				uint64_t nodes = 0;
+				std::string move;
+				auto bound = false;
+
+				while (is >> token)
+				{
+					if (token == "lowerbound" || token == "upperbound")
+						bound = true;
+					else if (token == "depth")
+						is >> depth;
+					else if (token == "nodes")
+						is >> nodes;
+					else if (token == "score")
+					{
+						is >> token >> score;
+						if (token == "mate")
+							score = score > 0 ? mate - 2 * score + 1 : -mate - 2 * score;
+					}
+					else if (token == "pv")
+						is >> move;
+				}
+
+				if (depth && !move.empty() && !bound)
+				{
+					std::lock_guard<std::mutex> lock(w->result_mutex);
+					w->best_move = move;
+					w->score = score;
+					w->depth = depth;
+					w->nodes = nodes;
+				}
+			}
+			else if (token == "bestmove")
+				w->searching = false;
+			else if (token == "tt")
+				receive(is, w);
+		}
+	}
+
+	w->alive = false;
+	w->searching = false;
+}
+
+void cluster_pool::send(worker* w, const std::string& line) const
+{
+	const auto message = line + "\n";
+	std::lock_guard<std::mutex> lock(w->send_mutex);
+	if (::send(w->fd, message.data(), message.size(), MSG_NOSIGNAL) < 0)
+		w->alive = false;
+}
+
+#else
+
+bool cluster_pool::listen(const std::string&, int)
+{
+	return false;
+}
+
+bool cluster_pool::join(const std::string&, int)
+{
+	return false;
+}
+
+void cluster_pool::close()
+{
+}
+
+void cluster_pool::accept_loop()
+{
+}
+
+void cluster_pool::read_loop(worker*)
+{
+}
+
+void cluster_pool::send(worker*, const std::string&) const
+{
+}
+
+#endif
+
+void cluster_pool::set_position(const std::string& position)
+{
+	position_ = position;
+}
+
+Search::root_moves cluster_pool::search_start(const Search::root_moves& root_moves, const Search::search_params& sp)
+{
+	std::lock_guard<std::mutex> lock(workers_mutex_);
+	std::vector<worker*> idle;
+
+	for (auto& w : workers_)
+	{
+		w->nodes = 0;
+		w->depth = 0;
+		if (w->alive)
+			idle.push_back(w.get());
+	}
+
+	if (idle.empty() || root_moves.size() < 2)
+		return root_moves;
+
+	// round robin keeps the best ordered moves spread over all processes
+	const auto parts = std::min(idle.size() + 1, root_moves.size());
+	Search::root_moves own;
+	std::vector<std::string> go(parts, "go searchmoves");
+
+	for (size_t i = 0; i < root_moves.size(); ++i)
+	{
+		if (i % parts == 0)
+			own.push_back(root_moves[i]);
+		else
+			go[i % parts] += " " + Uci::move_to_str(root_moves[i].pv[0]);
+	}
+
+	const auto limit = sp.depth ? " depth " + std::to_string(sp.depth) : std::string(" infinite");
+
+	{
+		std::lock_guard<std::shared_mutex> tt_lock(tt_mutex_);
+		tt_open_ = true;
+	}
+
+	for (size_t p = 1; p < parts; ++p)
+	{
+		auto* w = idle[p - 1];
+		w->searching = true;
+		send(w, position_);
+		send(w, go[p] + limit);
+	}
+
+	return own;
+}
+
+void cluster_pool::stop_and_wait(const bool stop)
+{
+	std::vector<worker*> busy;
+	{
+		std::lock_guard<std::mutex> lock(workers_mutex_);
+		for (auto& w : workers_)
+			if (w->searching)
+				busy.push_back(w.get());
+	}
+
+	for (auto* w : busy)
+	{
+		if (stop)
+			send(w, "stop");
+		while (w->searching && w->alive)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	std::lock_guard<std::shared_mutex> tt_lock(tt_mutex_);
+	tt_open_ = false;
+}
+
+bool cluster_pool::best_result(const bit_board& board, Move& move, int& score, const int depth)
+{
+	std::lock_guard<std::mutex> lock(workers_mutex_);
+
+	// results more than one iteration shallower than the deepest one are not compared
+	auto max_depth = depth;
+	for (auto& w : workers_)
+		max_depth = std::max(max_depth, w->depth.load());
+
+	auto best_score = depth >= max_depth - 1 ? score : -inf;
+	auto replaced = false;
+
+	for (auto& w : workers_)
+	{
+		std::lock_guard<std::mutex> result_lock(w->result_mutex);
+		if (!w->depth || w->depth < max_depth - 1 || w->score <= best_score)
+			continue;
+
+		auto move_str = w->best_move;
+		const auto m = UCI::str_to_move(board, move_str);
+		if (m == move_none)
+			continue;
+
+		move = m;
+		best_score = score = w->score;
+		replaced = true;
+	}
+
+	return replaced;
+}
+
+uint64_t cluster_pool::nodes() const
+{
+	std::lock_guard<std::mutex> lock(workers_mutex_);
+	uint64_t total = 0;
+	for (auto& w : workers_)
+		total += w->nodes;
+	return total;
+}
+
+void cluster_pool::share(const uint64_t key, const hash_entry* entry)
+{
+	tt_data tte;
+	if (!entry->read(key, tte))
+		return;
+
+	queue("tt " + std::to_string(key) + " " + std::to_string(tte.data), nullptr);
+}
+
+// a tt line from another process: keep the deeper entry, and on the master pass it on to the other workers
+void cluster_pool::receive(std::istringstream& input, const worker* from)
+{
+	uint64_t key = 0;
+	tt_data tte;
+	if (!(input >> key >> tte.data))
+		return;
+
+	// a worker reads tt lines on its uci thread, which is the one that allocates the table
+	std::shared_lock<std::shared_mutex> tt_lock(tt_mutex_, std::defer_lock);
+	if (!is_worker_)
+	{
+		tt_lock.lock();
+		if (!tt_open_)
+			return;
+	}
+
+	if (!tt.allocated())
+		return;
+
+	bool hit;
+	tt_data old;
+	auto* entry = tt.probe(key, hit, old);
+	if (!hit || old.depth() < tte.depth())
+		entry->save(key, tte.depth(), tte.eval(), tte.static_eval(), tte.move(), static_cast<flag>(tte.bound()), tt.age());
+
+	if (!is_worker_)
+		queue("tt " + std::to_string(key) + " " + std::to_string(tte.data), from);
+}
+
+void cluster_pool::queue(std::string line, const worker* from)
+{
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex_);
+		if (sender_exit_ || queue_.size() >= max_queued)
+			return;
+		queue_.push_back({std::move(line), from});
+	}
+	queue_cv_.notify_one();
+}
+
+void cluster_pool::start_sender()
+{
+	if (sender_.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex_);
+		sender_exit_ = false;
+	}
+	sender_ = std::thread(&cluster_pool::send_loop, this);
+}
+
+void cluster_pool::stop_sender()
+{
+	if (!sender_.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex_);
+		sender_exit_ = true;
+	}
+	queue_cv_.notify_one();
+	sender_.join();
+	queue_.clear();
+}
+
+void cluster_pool::send_loop()
+{
+	std::deque<shared_line> lines;
+	std::vector<worker*> targets;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(queue_mutex_);
+			queue_cv_.wait(lock, [&] { return sender_exit_ || !queue_.empty(); });
+			if (sender_exit_)
+				return;
+			lines.swap(queue_);
+		}
+
+		// a worker writes to its master over stdout, the master to every other searching worker
+		if (is_worker_)
+		{
+			for (auto& l : lines)
+				sync_out << l.line << sync_endl;
+			lines.clear();
+			continue;
+		}
+
+		// workers are only removed by close(), which stops this thread first
+		targets.clear();
+		{
+			std::lock_guard<std::mutex> lock(workers_mutex_);
+			for (auto& w : workers_)
+				if (w->searching)
+					targets.push_back(w.get());
+		}
+
+		for (auto& l : lines)
+			for (auto* w : targets)
+				if (w != l.from)
+					send(w, l.line);
+		lines.clear();
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "search.h"
+
+class bit_board;
+class hash_entry;
+
+// one logical search over several engine processes. the master splits the root moves between itself and the
+// workers connected to its port, which run them as plain uci searches; deep tt entries are passed both ways
+class cluster_pool
+{
+	struct worker
+	{
+		int fd = -1;
+		std::thread reader;
+		std::mutex send_mutex;
+		std::atomic<bool> alive{true}, searching{false};
+		std::atomic<uint64_t> nodes{0};
+		std::atomic<int> depth{0}, score{0};
+		std::string best_move;
+		std::mutex result_mutex;
+	};
+
+public:
+	~cluster_pool();
+	bool listen(const std::string& address, int port);
+	bool join(const std::string& host, int port);
+	void close();
+
+	[[nodiscard]] bool active() const
+	{
+		return active_;
+	}
+
+	[[nodiscard]] bool is_worker() const
+	{
+		return is_worker_;
+	}
+
+	void set_position(const std::string& position);
+	Search::root_moves search_start(const Search::root_moves& root_moves, const Search::search_params& sp);
+	void stop_and_wait(bool stop);
+	bool best_result(const bit_board& board, Move& move, int& score, int depth);
+	[[nodiscard]] uint64_t nodes() const;
+
+	void share(uint64_t key, const hash_entry* entry);
+	void receive(std::istringstream& input, const worker* from = nullptr);
+
+	static constexpr int share_depth = 8;
+
+private:
+	// a tt line waiting for the sender thread, with the worker it came from when it is forwarded
+	struct shared_line
+	{
+		std::string line;
+		const worker* from;
+	};
+
+	// tt sharing is best effort: past this many queued lines new ones are dropped
+	static constexpr size_t max_queued = 4096;
+
+	void accept_loop();
+	void read_loop(worker* w);
+	void send(worker* w, const std::string& line) const;
+	void queue(std::string line, const worker* from);
+	void start_sender();
+	void stop_sender();
+	void send_loop();
+
+	int listen_fd_ = -1;
+	std::thread acceptor_;
+	std::vector<std::unique_ptr<worker>> workers_;
+	mutable std::mutex workers_mutex_;
+	std::string position_ = "position startpos";
+	std::atomic<bool> active_{false};
+	bool is_worker_ = false;
+
+	// the master applies tt lines from its workers only while they search. the uci thread can reallocate
+	// the table between searches, so the flag is cleared under the lock that every receive holds shared
+	std::shared_mutex tt_mutex_;
+	bool tt_open_ = false;
+
+	// socket writes for tt lines happen only on this thread, never on a search thread
+	std::thread sender_;
+	std::deque<shared_line> queue_;
+	std::mutex queue_mutex_;
+	std::condition_variable queue_cv_;
+	bool sender_exit_ = true;
+};
+
+extern cluster_pool cluster;
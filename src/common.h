@@ -1,7 +1,11 @@
 #pragma once
 #include <algorithm>
 #include <cstdint>
+#ifdef _MSC_VER
 #include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 #include <chrono>
 #include <cmath>
 #include <cstring>
@@ -62,6 +66,7 @@ constexpr auto depth_qs = 0;
 constexpr auto depth_qs_no_check = -2;
 
 constexpr auto inf = 32001;
+constexpr auto value_none = 32002;
 constexpr auto mate = 32000;
 constexpr auto mate_in_max_ply = 31872;
 constexpr auto mated_in_max_ply = -31872;
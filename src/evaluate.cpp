@@ -5,6 +5,7 @@
 #include "psqtables.h"
 #include "pawns.h"
 #include "evaluate.h"
+#include "threads.h"
 
 const Score rook_on_pawn = S(3, 10);
 const Score rook_half_open = S(8, 4);
@@ -491,6 +492,19 @@ Score unstoppable_pawns(const eval_info& ev)
 }
 
 int Evaluate::evaluate(const bit_board& board) const
+{
+	auto& cache = board.this_thread()->eval_table;
+	const auto key = board.tt_key();
+
+	if (int value; cache.probe(key, value))
+		return value;
+
+	const auto value = evaluate_position(board);
+	cache.save(key, value);
+	return value;
+}
+
+int Evaluate::evaluate_position(const bit_board& board)
 {
 	const auto color = board.stm();
 	eval_info ev;
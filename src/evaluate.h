@@ -9,6 +9,7 @@ class Evaluate
 public:
 	[[nodiscard]] int evaluate(const bit_board& board) const;
 private:
+	[[nodiscard]] static int evaluate_position(const bit_board& board);
 	static int w_king_shield(const bit_board& board);
 	static int b_king_shield(const bit_board& board);
 	static bool is_piece(const uint64_t& piece, const bit_board& board, int sq);
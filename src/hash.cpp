@@ -1,58 +1,389 @@
 #include "hash.h"
 
+#include <cstdio>
 #include <iostream>
 #include <cstring>
+#include <thread>
 #include "bitops.h"
+#include "threads.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 transposition_table tt;
+perft_hash_table perft_tt;
 
 void transposition_table::resize(const size_t mb_size)
 {
-	const auto new_cluster_count = static_cast<size_t>(1) << msb(mb_size * 1024 * 1024 / sizeof(tt_cluster));
+	mb_size_ = mb_size;
+}
+
+bool transposition_table::allocate()
+{
+	const auto new_cluster_count = static_cast<size_t>(1) << msb(mb_size_ * 1024 * 1024 / sizeof(tt_cluster));
 
 	if (new_cluster_count == cluster_count_)
-		return;
+		return false;
 
+	free_table();
 	cluster_count_ = new_cluster_count;
-	free(mem_);
-	mem_ = calloc(cluster_count_ * sizeof(tt_cluster) + cache_line_size - 1, 1);
+	map_memory(cluster_count_ * sizeof(tt_cluster));
+	clear_table();
+	return true;
+}
+
+void transposition_table::map_memory(const size_t size)
+{
+#if defined(__linux__)
+	if (large_pages_)
+	{
+		constexpr size_t huge_page_size = 2 * 1024 * 1024;
+		mem_size_ = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+		mem_ = mmap(nullptr, mem_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if (mem_ != MAP_FAILED)
+		{
+			page_mode_ = pages_huge;
+			table_ = static_cast<tt_cluster*>(mem_);
+			return;
+		}
+
+		// no reserved huge pages: over-allocate so the table can start on a 2 MB boundary and ask for THP
+		mem_size_ += huge_page_size;
+		mem_ = mmap(nullptr, mem_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (mem_ != MAP_FAILED)
+		{
+			auto* const aligned = reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(mem_) + huge_page_size - 1 & ~(huge_page_size - 1));
+			page_mode_ = madvise(aligned, size, MADV_HUGEPAGE) ? pages_default : pages_transparent;
+			table_ = static_cast<tt_cluster*>(aligned);
+			return;
+		}
+		mem_ = nullptr;
+		mem_size_ = 0;
+	}
+#endif
+
+	page_mode_ = pages_default;
+	mem_ = calloc(size + cache_line_size - 1, 1);
 
 	if (!mem_)
 	{
-		std::cerr << "Failed to allocate " << mb_size << "MB for transposition table." << std::endl;
+		std::cerr << "Failed to allocate " << mb_size_ << "MB for transposition table." << std::endl;
 		exit(EXIT_FAILURE);
 	}
 
 	table_ = reinterpret_cast<tt_cluster*>(reinterpret_cast<uintptr_t>(mem_) + cache_line_size - 1 & ~(cache_line_size - 1));
 }
 
+void transposition_table::large_pages(const bool enable)
+{
+	if (enable == large_pages_)
+		return;
+
+	large_pages_ = enable;
+	free_table();
+}
+
+void transposition_table::free_table()
+{
+#if defined(__linux__)
+	if (mem_size_)
+		munmap(mem_, mem_size_);
+	else
+#endif
+		free(mem_);
+
+	mem_ = nullptr;
+	mem_size_ = 0;
+	table_ = nullptr;
+	cluster_count_ = 0;
+}
+
+const char* transposition_table::page_mode_str() const
+{
+	return page_mode_ == pages_huge ? "huge pages" : page_mode_ == pages_transparent ? "transparent huge pages" : "default pages";
+}
+
 void transposition_table::clear_table() const
 {
-	std::memset(table_, 0, cluster_count_ * sizeof(tt_cluster));
+	if (!cluster_count_)
+		return;
+
+	if (threads.empty())
+	{
+		std::memset(table_, 0, cluster_count_ * sizeof(tt_cluster));
+		return;
+	}
+
+	// each search thread zeroes (and so first touches) its own slice
+	const auto slices = threads.size();
+	const auto stride = cluster_count_ / slices;
+
+	for (size_t i = 0; i < slices; ++i)
+	{
+		threads[i]->execute([this, i, slices, stride]
+		{
+			const auto start = stride * i;
+			const auto count = i + 1 == slices ? cluster_count_ - start : stride;
+			std::memset(&table_[start], 0, count * sizeof(tt_cluster));
+		});
+	}
+
+	for (auto* th : threads)
+		th->wait_for_search_stop();
 }
 
-hash_entry* transposition_table::probe(const uint64_t key, bool& hit) const
+hash_entry* transposition_table::probe(const uint64_t key, bool& hit, tt_data& tte) const
 {
-	const uint16_t key16 = key >> 48;
-	auto* const tte = first_entry(key);
+	if (track_stats_)
+		record_probe(key);
+
+	auto* const tte_first = first_entry(key);
+	uint8_t flags[tt_cluster_size];
+	int depths[tt_cluster_size];
 
 	for (auto i = 0; i < tt_cluster_size; ++i)
 	{
-		if (!tte[i].zobrist16_ || tte[i].zobrist16_ == key16)
+		const auto data = tte_first[i].data64_.load(std::memory_order_relaxed);
+		const auto key64 = tte_first[i].key64_.load(std::memory_order_relaxed);
+
+		if ((key64 ^ data) == key)
 		{
-			if ((tte[i].flag8_ & 0xFC) != age8_ && tte[i].zobrist16_)
-				tte[i].flag8_ = static_cast<uint8_t>(age8_ | tte[i].bound());
+			tte.data = data;
 
-			return hit = static_cast<bool>(tte[i].zobrist16_), &tte[i];
+			if ((tte.flag() & 0xFC) != age8_)
+				tte_first[i].store(key, tt_data::pack(tte.depth(), tte.eval(), tte.static_eval(), tte.move(), static_cast<uint8_t>(age8_ | tte.bound())));
+
+			return hit = true, &tte_first[i];
 		}
+
+		if (!key64 && !data)
+			return tte.data = 0, hit = false, &tte_first[i];
+
+		flags[i] = tt_data{data}.flag();
+		depths[i] = tt_data{data}.depth();
 	}
-	auto* replace = tte;
+	auto replace = 0;
+
+	for (auto i = 1; i < tt_cluster_size; ++i)
+	{
+		if (depths[replace] - (259 + age8_ - flags[replace] & 0xFC) * 2
+			> depths[i] - (259 + age8_ - flags[i] & 0xFC) * 2)
+			replace = i;
+	}
+	return tte.data = 0, hit = false, &tte_first[replace];
+}
+
+// a 16-bit key check (the old 8-byte entry) would have returned the first entry whose top bits match
+void transposition_table::record_probe(const uint64_t key) const
+{
+	const auto* const tte = first_entry(key);
+	++stats_.probes;
 
 	for (auto i = 0; i < tt_cluster_size; ++i)
 	{
-		if (replace->depth8_ - (259 + age8_ - replace->flag8_ & 0xFC) * 2
-			> tte[i].depth8_ - (259 + age8_ - tte[i].flag8_ & 0xFC) * 2)
-			replace = &tte[i];
+		const auto data = tte[i].data64_.load(std::memory_order_relaxed);
+		const auto key64 = tte[i].key64_.load(std::memory_order_relaxed);
+
+		if ((key64 ^ data) == key)
+		{
+			++stats_.hits;
+			return;
+		}
+
+		if (!key64 && !data)
+			return;
+
+		if ((key64 ^ data) >> 48 == key >> 48)
+		{
+			++stats_.key16_collisions;
+			return;
+		}
+	}
+}
+
+void transposition_table::stress_test(const int thread_count)
+{
+	constexpr auto iterations = 1 << 22;
+	transposition_table table;
+	table.resize(1);
+	table.allocate();
+	std::atomic<uint64_t> hits = 0, corrupted = 0;
+	std::vector<std::thread> workers;
+
+	// every key maps to cluster 0; the stored fields are derived from the key so a reader can check them
+	const auto key_of = [](const uint64_t n) { return (n + 1) * 0x9E3779B97F4A7C15ULL & ~0xFFFFFULL; };
+	const auto move_of = [](const uint64_t key) { return static_cast<Move>(key >> 48 | 1); };
+	const auto eval_of = [](const uint64_t key) { return static_cast<int>(static_cast<int16_t>(key >> 32)); };
+	const auto depth_of = [](const uint64_t key) { return static_cast<int>(key >> 24 & 63); };
+
+	for (auto t = 0; t < thread_count; ++t)
+		workers.emplace_back([&, t]
+		{
+			uint64_t h = 0, c = 0;
+			for (uint64_t i = 0; i < iterations; ++i)
+			{
+				const auto key = key_of(i * thread_count + t & 63);
+				bool hit;
+				tt_data tte;
+				auto* const entry = table.probe(key, hit, tte);
+
+				if (hit)
+				{
+					++h;
+					if (tte.move() != move_of(key) || tte.eval() != eval_of(key) || tte.depth() != depth_of(key))
+						++c;
+				}
+				entry->store(key, tt_data::pack(depth_of(key), eval_of(key), value_none, move_of(key), exact | table.age()));
+			}
+			hits += h;
+			corrupted += c;
+		});
+
+	for (auto& w : workers)
+		w.join();
+
+	std::cout << "Threads  : " << thread_count << std::endl;
+	std::cout << "Probes   : " << static_cast<uint64_t>(iterations) * thread_count << std::endl;
+	std::cout << "Hits     : " << hits << std::endl;
+	std::cout << "Corrupted: " << corrupted << std::endl;
+}
+
+bool transposition_table::save(const std::string& file_name, const uint64_t signature) const
+{
+	if (!cluster_count_)
+		return false;
+
+	FILE* f = fopen(file_name.c_str(), "wb");
+
+	if (!f)
+		return false;
+
+	file_header header{};
+	std::memcpy(header.magic, file_magic, sizeof header.magic);
+	header.version = file_version;
+	header.cluster_size = sizeof(tt_cluster);
+	header.cluster_count = cluster_count_;
+	header.signature = signature;
+	header.age = age8_;
+
+	const auto ok = fwrite(&header, sizeof header, 1, f) == 1
+		&& fwrite(table_, sizeof(tt_cluster), cluster_count_, f) == cluster_count_;
+
+	return fclose(f) == 0 && ok;
+}
+
+bool transposition_table::load(const std::string& file_name, const uint64_t signature)
+{
+	const auto valid = [signature](const file_header& header, const size_t file_size)
+	{
+		return !std::memcmp(header.magic, file_magic, sizeof header.magic)
+			&& header.version == file_version
+			&& header.cluster_size == sizeof(tt_cluster)
+			&& header.signature == signature
+			&& header.cluster_count >= 1024 * 1024 / sizeof(tt_cluster)
+			&& !(header.cluster_count & header.cluster_count - 1)
+			&& file_size == sizeof header + header.cluster_count * sizeof(tt_cluster);
+	};
+
+	// the table keeps the configured Hash size, a file of another size is rehashed into it
+	const auto adopt = [this](const file_header& header)
+	{
+		allocate();
+		age8_ = header.age;
+	};
+
+#if defined(__linux__)
+	const auto fd = open(file_name.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat st{};
+	void* map = MAP_FAILED;
+
+	if (!fstat(fd, &st) && static_cast<size_t>(st.st_size) >= sizeof(file_header))
+		map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return false;
+
+	const auto& header = *static_cast<const file_header*>(map);
+	const auto ok = valid(header, st.st_size);
+
+	if (ok)
+	{
+		madvise(map, st.st_size, MADV_SEQUENTIAL);
+		adopt(header);
+		import(reinterpret_cast<const tt_cluster*>(static_cast<const char*>(map) + sizeof header), header.cluster_count);
+	}
+	munmap(map, st.st_size);
+	return ok;
+#else
+	FILE* f = fopen(file_name.c_str(), "rb");
+
+	if (!f)
+		return false;
+
+	file_header header{};
+	fseek(f, 0, SEEK_END);
+	const auto file_size = static_cast<size_t>(ftell(f));
+	fseek(f, 0, SEEK_SET);
+
+	auto ok = fread(&header, sizeof header, 1, f) == 1 && valid(header, file_size);
+
+	if (ok)
+	{
+		adopt(header);
+
+		if (header.cluster_count == cluster_count_)
+			ok = fread(table_, sizeof(tt_cluster), cluster_count_, f) == cluster_count_;
+		else
+		{
+			const auto clusters = std::make_unique<tt_cluster[]>(header.cluster_count);
+			ok = fread(clusters.get(), sizeof(tt_cluster), header.cluster_count, f) == header.cluster_count;
+			if (ok)
+				import(clusters.get(), header.cluster_count);
+		}
+
+		if (!ok)
+			clear_table();
+	}
+	fclose(f);
+	return ok;
+#endif
+}
+
+void transposition_table::import(const tt_cluster* clusters, const size_t count)
+{
+	if (count == cluster_count_)
+	{
+		std::memcpy(static_cast<void*>(table_), clusters, count * sizeof(tt_cluster));
+		return;
 	}
-	return hit = false, replace;
+
+	// every entry carries its full key, so it can be stored again wherever it maps in this table
+	clear_table();
+
+	for (size_t c = 0; c < count; ++c)
+		for (const auto& e : clusters[c].entry)
+		{
+			const tt_data tte{e.data64_.load(std::memory_order_relaxed)};
+			const auto key = e.key64_.load(std::memory_order_relaxed) ^ tte.data;
+
+			if (!tte.data)
+				continue;
+
+			bool hit;
+			tt_data old;
+			auto* const entry = probe(key, hit, old);
+			if (!hit || old.depth() < tte.depth())
+				entry->store(key, tte.data);
+		}
 }
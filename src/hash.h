@@ -1,53 +1,102 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <string>
 #include <vector>
+#include "bitops.h"
 #include "common.h"
 
-class hash_entry
+// snapshot of a hash_entry, decoded from one verified read of its data word:
+// move 16 | value 16 | depth 8 | bound 2 + age 6 | static eval 16
+class tt_data
 {
 public:
-
 	[[nodiscard]] Move move() const
 	{
-		return static_cast<Move>(move16_);
+		return static_cast<Move>(data & 0xFFFF);
 	}
 
-	[[nodiscard]] int depth() const
+	[[nodiscard]] int eval() const
 	{
-		return depth8_;
+		return static_cast<int16_t>(data >> 16 & 0xFFFF);
 	}
 
-	[[nodiscard]] int eval() const
+	[[nodiscard]] int depth() const
 	{
-		return eval16_;
+		return static_cast<uint8_t>(data >> 32 & 0xFF);
 	}
 
 	[[nodiscard]] int bound() const
 	{
-		return static_cast<flag>(flag8_) & 0x3;
+		return static_cast<int>(data >> 40) & 0x3;
 	}
 
-	void save(const uint64_t key, const int d, const int e, const Move m, const flag hash_flag, const uint8_t age)
+	[[nodiscard]] uint8_t flag() const
 	{
-		if (m || key >> 48 != zobrist16_)
-			move16_ = static_cast<uint16_t>(m);
+		return static_cast<uint8_t>(data >> 40 & 0xFF);
+	}
 
-		if (key >> 48 != zobrist16_ || d > depth8_ - 4 || hash_flag == exact)
-		{
-			depth8_ = static_cast<uint8_t>(d);
-			flag8_ = static_cast<uint8_t>(hash_flag) | age;
-			eval16_ = static_cast<int16_t>(e);
-			zobrist16_ = static_cast<uint16_t>(key >> 48);
-		}
+	[[nodiscard]] int static_eval() const
+	{
+		return static_cast<int16_t>(data >> 48);
+	}
+
+	static uint64_t pack(const int d, const int e, const int ev, const Move m, const uint8_t flag8)
+	{
+		return static_cast<uint64_t>(static_cast<uint16_t>(m))
+			| static_cast<uint64_t>(static_cast<uint16_t>(e)) << 16
+			| static_cast<uint64_t>(static_cast<uint8_t>(d)) << 32
+			| static_cast<uint64_t>(flag8) << 40
+			| static_cast<uint64_t>(static_cast<uint16_t>(ev)) << 48;
+	}
+
+	uint64_t data = 0;
+};
+
+// lockless entry: the key is stored xor'ed with the data word, so a torn
+// write (key and data from different saves) never verifies as a hit
+class hash_entry
+{
+public:
+	void save(const uint64_t key, const int d, const int e, const int ev, const Move m, const flag hash_flag, const uint8_t age)
+	{
+		const tt_data old{data64_.load(std::memory_order_relaxed)};
+		const auto same_key = (key64_.load(std::memory_order_relaxed) ^ old.data) == key;
+		const auto move = m || !same_key ? m : old.move();
+		const auto static_eval = ev != value_none || !same_key ? ev : old.static_eval();
+
+		if (!same_key || d > old.depth() - 4 || hash_flag == exact)
+			store(key, tt_data::pack(d, e, static_eval, move, static_cast<uint8_t>(hash_flag) | age));
+		else if (move != old.move() || static_eval != old.static_eval())
+			store(key, tt_data::pack(old.depth(), old.eval(), static_eval, move, old.flag()));
+	}
+
+	// one verified read of the entry, false if it no longer holds key
+	bool read(const uint64_t key, tt_data& tte) const
+	{
+		tte.data = data64_.load(std::memory_order_relaxed);
+		return (key64_.load(std::memory_order_relaxed) ^ tte.data) == key;
 	}
 
 private:
 	friend class transposition_table;
 
-	uint8_t flag8_;
-	uint8_t depth8_;
-	int16_t eval16_;
-	uint16_t move16_;
-	uint16_t zobrist16_;
+	void store(const uint64_t key, const uint64_t data)
+	{
+		data64_.store(data, std::memory_order_relaxed);
+		key64_.store(key ^ data, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t> key64_;
+	std::atomic<uint64_t> data64_;
+};
+
+struct tt_stats
+{
+	uint64_t probes;
+	uint64_t hits;
+	uint64_t cutoffs;
+	uint64_t key16_collisions;
 };
 
 class transposition_table
@@ -59,16 +108,74 @@ class transposition_table
 		hash_entry entry[tt_cluster_size];
 	};
 
+	static_assert(sizeof(tt_cluster) == cache_line_size, "tt_cluster must fill one cache line");
+
+	// hash file layout: this header, then the clusters exactly as they are in memory
+	struct file_header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t cluster_size;
+		uint64_t cluster_count;
+		uint64_t signature;
+		uint8_t age;
+		uint8_t pad[cache_line_size - 33];
+	};
+
+	static_assert(sizeof(file_header) == cache_line_size, "file_header must fill one cache line");
+	static constexpr char file_magic[8] = "RAZERTT";
+	static constexpr uint32_t file_version = 1;
+
 public:
+	enum page_mode
+	{
+		pages_default,
+		pages_transparent,
+		pages_huge
+	};
+
 	~transposition_table()
 	{
-		free(mem_);
+		free_table();
 	}
 
-	hash_entry* probe(uint64_t key, bool& hit) const;
+	hash_entry* probe(uint64_t key, bool& hit, tt_data& tte) const;
 	[[nodiscard]] hash_entry* first_entry(uint64_t key) const;
 	void resize(size_t mb_size);
+	bool allocate();
+	void large_pages(bool enable);
 	void clear_table() const;
+	[[nodiscard]] const char* page_mode_str() const;
+
+	[[nodiscard]] size_t mb_size() const
+	{
+		return mb_size_;
+	}
+
+	[[nodiscard]] bool allocated() const
+	{
+		return table_ != nullptr;
+	}
+
+	void track_stats(const bool enable)
+	{
+		track_stats_ = enable;
+		stats_ = {};
+	}
+
+	void record_cutoff() const
+	{
+		if (track_stats_)
+			++stats_.cutoffs;
+	}
+
+	[[nodiscard]] const tt_stats& stats() const
+	{
+		return stats_;
+	}
+	static void stress_test(int thread_count);
+	bool save(const std::string& file_name, uint64_t signature) const;
+	bool load(const std::string& file_name, uint64_t signature);
 
 	[[nodiscard]] uint8_t age() const
 	{
@@ -81,9 +188,20 @@ public:
 	}
 
 private:
+	void map_memory(size_t size);
+	void free_table();
+	void import(const tt_cluster* clusters, size_t count);
+	void record_probe(uint64_t key) const;
+
 	size_t cluster_count_ = 0;
 	tt_cluster* table_ = nullptr;
 	void* mem_ = nullptr;
+	size_t mem_size_ = 0;
+	size_t mb_size_ = 0;
+	page_mode page_mode_ = pages_default;
+	bool large_pages_ = true;
+	bool track_stats_ = false;
+	mutable tt_stats stats_{};
 	uint8_t age8_ = 0;
 };
 
@@ -109,3 +227,98 @@ struct hash_table
 private:
 	std::vector<Entry> table_;
 };
+
+// direct-mapped evaluation cache: the top 48 key bits and the 16-bit score share one word
+class eval_hash_table
+{
+public:
+	void resize(const size_t mb_size)
+	{
+		const auto count = mb_size * 1024 * 1024 / sizeof(uint64_t);
+		table_.assign(count ? static_cast<size_t>(1) << msb(count) : 0, 0);
+		mask_ = table_.empty() ? 0 : table_.size() - 1;
+	}
+
+	bool probe(const uint64_t key, int& value)
+	{
+		if (table_.empty())
+			return false;
+
+		++probes;
+		const auto e = table_[key & mask_];
+
+		if (!e || (e ^ key) & ~0xFFFFULL)
+			return false;
+
+		++hits;
+		value = static_cast<int16_t>(e & 0xFFFF);
+		return true;
+	}
+
+	void save(const uint64_t key, const int value)
+	{
+		if (!table_.empty())
+			table_[key & mask_] = (key & ~0xFFFFULL) | static_cast<uint16_t>(value);
+	}
+
+	uint64_t probes = 0;
+	uint64_t hits = 0;
+
+private:
+	std::vector<uint64_t> table_;
+	size_t mask_ = 0;
+};
+
+// subtree counts for perft, shared by all perft threads and kept from one perft to the next. keyed by
+// position and remaining depth; the key is stored xor'ed with the count, so a torn write never verifies as a hit
+class perft_hash_table
+{
+	struct entry
+	{
+		std::atomic<uint64_t> key;
+		std::atomic<uint64_t> nodes;
+	};
+
+public:
+	void resize(const size_t mb_size)
+	{
+		const auto count = mb_size * 1024 * 1024 / sizeof(entry);
+		size_ = count ? static_cast<size_t>(1) << msb(count) : 0;
+		table_ = size_ ? std::make_unique<entry[]>(size_) : nullptr;
+	}
+
+	[[nodiscard]] bool enabled() const
+	{
+		return size_ != 0;
+	}
+
+	[[nodiscard]] size_t mb_size() const
+	{
+		return size_ * sizeof(entry) >> 20;
+	}
+
+	static uint64_t perft_key(const uint64_t key, const int depth)
+	{
+		return key ^ static_cast<uint64_t>(depth) * 0x9E3779B97F4A7C15ULL;
+	}
+
+	bool probe(const uint64_t key, uint64_t& nodes) const
+	{
+		const auto& e = table_[key & size_ - 1];
+		nodes = e.nodes.load(std::memory_order_relaxed);
+		return (e.key.load(std::memory_order_relaxed) ^ nodes) == key;
+	}
+
+	void save(const uint64_t key, const uint64_t nodes) const
+	{
+		auto& e = table_[key & size_ - 1];
+		e.nodes.store(nodes, std::memory_order_relaxed);
+		e.key.store(key ^ nodes, std::memory_order_relaxed);
+	}
+
+private:
+	std::unique_ptr<entry[]> table_;
+	size_t size_ = 0;
+};
+
+extern perft_hash_table perft_tt;
@@ -48,7 +48,7 @@ inline Move create_move(const int from, const int to)
 template <movetype T, int Pt>
 Move create_special(const int from, const int to)
 {
-	return static_cast<Move>(from | static_cast<unsigned long long>(to) << 6 | T | (static_cast<unsigned __int64>(Pt)
-		                                               ? static_cast<unsigned __int64>(Pt - knight) << 15
+	return static_cast<Move>(from | static_cast<unsigned long long>(to) << 6 | T | (static_cast<uint64_t>(Pt)
+		                                               ? static_cast<uint64_t>(Pt - knight) << 15
 		                                               : 0LL));
 }
@@ -58,6 +58,15 @@ move_picker::move_picker(const bit_board& board, Move ttm, const move_history* h
 	stage_ += tt_move_ == move_none;
 }
 
+// probcut: captures only, each winning at least threshold by see
+move_picker::move_picker(const bit_board& board, const Move ttm, const int threshold) : b_(board), move_hist_(nullptr),
+	threshold_(threshold), counter_move_()
+{
+	stage_ = probcut;
+	tt_move_ = ttm && b_.capture_or_promotion(ttm) && b_.pseudo_legal(ttm) && b_.see_ge(ttm, threshold) ? ttm : move_none;
+	stage_ += tt_move_ == move_none;
+}
+
 template <>
 void move_picker::score<captures>()
 {
@@ -112,6 +121,7 @@ Move move_picker::next_move()
 	case main_search:
 	case q_search:
 	case evasion:
+	case probcut:
 		++stage_;
 		return tt_move_;
 	case captures_init:
@@ -191,6 +201,19 @@ Move move_picker::next_move()
 			return m;
 		}
 		break;
+	case probcut_init:
+		current_ = m_list_;
+		end_ = generate<captures>(b_, current_);
+		score<captures>();
+		++stage_;
+	case probcut_captures:
+		while (current_ < end_)
+		{
+			m = pick(current_++, end_)->move;
+			if (m != tt_move_ && b_.see_ge(m, threshold_))
+				return m;
+		}
+		break;
 	default: ;
 	}
 	return move_none;
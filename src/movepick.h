@@ -19,6 +19,9 @@ enum stages
 	evasion,
 	evasions_init,
 	evasions_s1,
+	probcut,
+	probcut_init,
+	probcut_captures,
 	stop
 };
 
@@ -68,6 +71,7 @@ public:
 	move_picker(const bit_board& board, Move ttm, int depth, const move_history* hist, const piece_history**, Move cm,
 	           Move* killers_p);
 	move_picker(const bit_board& board, Move ttm, const move_history* hist);
+	move_picker(const bit_board& board, Move ttm, int threshold);
 	Move next_move();
 
 private:
@@ -78,6 +82,7 @@ private:
 	const move_history* move_hist_;
 	const piece_history** piece_sq_history_{};
 	int depth_{};
+	int threshold_{};
 	Move tt_move_, counter_move_;
 	s_move killers_[2]{};
 	s_move *current_ = nullptr, *end_ = nullptr, *end_bad_captures_ = nullptr, *end_quiet_moves_ = nullptr;
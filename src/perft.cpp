@@ -1,5 +1,6 @@
 #include "perft.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 
@@ -11,69 +12,115 @@
 
 using namespace std;
 
-void perft::idle()
+perft::perft(const bit_board& board, const int depth) :
+	root_(board), depth_(depth)
 {
-	std::unique_lock lock(mutex_);
-	cv_.wait(lock, [&] { return searching; });
-	lock.unlock();
-	start_search();
-}
+	for (const auto& m : move_list<legal>(board))
+		root_moves_.push_back(m);
 
-void perft::start_search()
-{
-	for (const auto& m : my_moves)
+	root_nodes_ = std::make_unique<std::atomic<uint64_t>[]>(root_moves_.size());
+	for (size_t i = 0; i < root_moves_.size(); ++i)
+		root_nodes_[i] = 0;
+
+	// split deeper until there are enough subtrees to keep every thread busy to the end,
+	// but always leave at least one ply below the cut for the bulk counting at the leaves
+	auto pos = board;
+	auto root_state = *board.state();
+	pos.set_state(&root_state, threads.main());
+	const auto target = threads.size() * subtrees_per_thread;
+
+	while (true)
 	{
-		search_move(m, depth);
-		if (is_divide)
-			sync_out << Uci::move_to_str(m) << ": " << move_nodes << sync_endl;
-		total_nodes += move_nodes;
+		subtrees_.clear();
+		subtree path{};
+		split(pos, 0, path);
+
+		if (subtrees_.size() >= target || split_ply_ + 1 >= depth_ || split_ply_ == max_split_ply)
+			break;
+		++split_ply_;
 	}
-	searching = false;
 }
 
-void perft::search_move(const Move m, const int d)
+void perft::split(bit_board& board, const int ply, subtree& path)
 {
+	if (ply == split_ply_)
+	{
+		subtrees_.push_back(path);
+		return;
+	}
+
+	state_info st{};
 	const auto color = board.stm();
-	board.make_move(m, si, color);
-	move_nodes = perft_divide<true>(d - 1);
-	board.unmake_move(m, color);
+	auto i = 0;
+
+	for (const auto& m : move_list<legal>(board))
+	{
+		if (!ply)
+			path.root = i++;
+		path.moves[ply] = m;
+		board.make_move(m, st, color);
+		split(board, ply + 1, path);
+		board.unmake_move(m, color);
+	}
 }
 
-void perft::perft_init(const bit_board& board, const bool is_divide, const int depth)
+void perft::work(::thread* th)
 {
-	const auto start = now();
-	std::vector<perft*> perft_threads;
-	const auto p_threads = static_cast<unsigned>(threads.size());
+	// a private copy of the root, counting its nodes on the thread that runs it
+	auto board = root_;
+	auto root_state = *root_.state();
+	board.set_state(&root_state, th);
 
-	if (perft_threads.size() != p_threads)
-		for (unsigned int i = 0; i < p_threads; ++i)
-			perft_threads.push_back(new perft);
+	state_info st[max_split_ply];
+	int color[max_split_ply];
+	hash_stats stats{};
+	size_t i;
 
-	auto i = 0;
-	for (const auto& m : move_list<legal>(board))
+	while ((i = next_.fetch_add(1, std::memory_order_relaxed)) < subtrees_.size())
 	{
-		perft_threads[i % p_threads]->my_moves.emplace_back(m);
-		++i;
-	}
+		const auto& s = subtrees_[i];
 
-	for (auto* th : perft_threads)
-	{
-		th->board = board;
-		th->depth = depth;
-		th->searching = true;
-		if (is_divide)
-			th->is_divide = true;
-		th->notify();
+		for (auto ply = 0; ply < split_ply_; ++ply)
+		{
+			color[ply] = board.stm();
+			board.make_move(s.moves[ply], st[ply], color[ply]);
+		}
+
+		const auto nodes = perft_divide(board, depth_ - split_ply_, stats);
+
+		for (auto ply = split_ply_ - 1; ply >= 0; --ply)
+			board.unmake_move(s.moves[ply], color[ply]);
+
+		root_nodes_[s.root].fetch_add(nodes, std::memory_order_relaxed);
 	}
 
+	probes_ += stats.probes;
+	hits_ += stats.hits;
+	th->flush_nodes();
+}
+
+void perft::perft_init(const bit_board& board, const bool is_divide, int depth)
+{
+	const auto start = now();
+	depth = std::max(depth, 1);
+	threads.main()->wait_for_search_stop();
+
+	perft p(board, depth);
+
+	for (auto* th : threads)
+		th->execute([&p, th] { p.work(th); });
+
+	for (auto* th : threads)
+		th->wait_for_search_stop();
+
 	uint64_t nodes = 0;
-	auto it = 0;
 
-	for (auto* th : perft_threads)
+	for (size_t i = 0; i < p.root_moves_.size(); ++i)
 	{
-		th->std_thread.join();
-		nodes += th->total_nodes;
-		delete perft_threads[it++];
+		const auto move_nodes = p.root_nodes_[i].load();
+		if (is_divide)
+			sync_out << Uci::move_to_str(p.root_moves_[i]) << ": " << move_nodes << sync_endl;
+		nodes += move_nodes;
 	}
 
 	const auto elapsed_time = static_cast<double>(now() + 1 - start) / 1000;
@@ -94,20 +141,41 @@ void perft::perft_init(const bit_board& board, const bool is_divide, const int d
 	ss << "NPS  : " << std::fixed << nps << endl;
 	cout << ss.str();
 	ss.str(std::string());
+
+	if (perft_tt.enabled())
+	{
+		const auto probes = p.probes_.load();
+		ss.precision(1);
+		ss << "Hash : " << perft_tt.mb_size() << " MB, " << p.hits_.load() << " hits of " << probes << " probes ("
+			<< (probes ? 100.0 * static_cast<double>(p.hits_.load()) / static_cast<double>(probes) : 0.0) << "%)" << endl;
+		cout << ss.str();
+		ss.str(std::string());
+	}
 	sync_indent;
 }
 
-template <bool Root>
-uint64_t perft::perft_divide(const int d)
+uint64_t perft::perft_divide(bit_board& board, const int d, hash_stats& stats)
 {
+	if (d <= 0)
+		return 1;
+
+	// below two plies the bulk counted leaves are cheaper than a probe
+	const auto hashed = d > 2 && perft_tt.enabled();
+	const auto key = perft_hash_table::perft_key(board.tt_key(), d);
+
+	if (hashed)
+	{
+		uint64_t nodes;
+		++stats.probes;
+		if (perft_tt.probe(key, nodes))
+			return ++stats.hits, nodes;
+	}
+
 	state_info st{};
 	uint64_t nodes = 0;
 	s_move m_list[256];
 	const auto* const end = generate<legal>(board, m_list);
 
-	if (d <= 0)
-		return 1;
-
 	const auto color = board.stm();
 	const auto leaf = d == 2;
 
@@ -115,11 +183,12 @@ uint64_t perft::perft_divide(const int d)
 	{
 		auto m = i->move;
 		board.make_move(m, st, color);
-		const auto count = leaf ? move_list<legal>(board).size() : perft_divide<false>(d - 1);
+		const auto count = leaf ? move_list<legal>(board).size() : perft_divide(board, d - 1, stats);
 		nodes += count;
 		board.unmake_move(m, color);
 	}
+
+	if (hashed)
+		perft_tt.save(key, nodes);
 	return nodes;
 }
-
-template uint64_t perft::perft_divide<true>(int depth);
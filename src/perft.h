@@ -1,38 +1,46 @@
 #pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "common.h"
 #include "threads.h"
 
+// perft on the engine thread pool. the tree is cut a few plies below the root into subtrees;
+// every pool thread takes the next unclaimed subtree until none are left, so one large root
+// move is shared by all threads instead of holding up the one it was dealt to
 class perft
 {
-	Mutex mutex_;
-	ConditionVariable cv_;
-
-public:
-	std::thread std_thread;
+	static constexpr int max_split_ply = 4;
+	static constexpr size_t subtrees_per_thread = 32;
 
-	perft() : std_thread(&perft::idle, this)
+	struct subtree
 	{
-	}
+		Move moves[max_split_ply];
+		int root;
+	};
 
-	void notify()
+	struct hash_stats
 	{
-		cv_.notify_one();
-	}
+		uint64_t probes;
+		uint64_t hits;
+	};
 
-	void idle();
-	void start_search();
+public:
 	static void perft_init(const bit_board& board, bool is_divide, int depth);
-	void search_move(Move m, int d);
 
-	template <bool Root>
-	uint64_t perft_divide(int d);
+private:
+	perft(const bit_board& board, int depth);
+	void split(bit_board& board, int ply, subtree& path);
+	void work(::thread* th);
+	static uint64_t perft_divide(bit_board& board, int d, hash_stats& stats);
 
-	bool searching = false;
-	bool is_divide = false;
-	int depth = 0;
-	uint64_t move_nodes = 0;
-	uint64_t total_nodes = 0;
-	std::vector<Move> my_moves;
-	state_info si{};
-	bit_board board;
+	const bit_board& root_;
+	int depth_;
+	int split_ply_ = 1;
+	std::vector<Move> root_moves_;
+	std::vector<subtree> subtrees_;
+	std::atomic<size_t> next_{0};
+	std::unique_ptr<std::atomic<uint64_t>[]> root_nodes_;
+	std::atomic<uint64_t> probes_{0}, hits_{0};
 };
@@ -5,6 +5,7 @@
 #include <sstream>
 
 #include "bitboard.h"
+#include "cluster.h"
 #include "evaluate.h"
 #include "hash.h"
 #include "movegen.h"
@@ -30,6 +31,7 @@ template <node_type Nt, bool InCheck>
 int quiescent(bit_board& board, int alpha, int beta, search_stack* ss, int depth);
 
 int tempo = 10;
+int aspiration_delta = 18;
 int reductions[2][2][64][64];
 int futility_move_count[2][32];
 int draw_value[Color];
@@ -39,15 +41,52 @@ namespace Search
 	search_params search_param;
 }
 
-constexpr int th_skip_size0 [] =
+// simplified abdada: moves some thread is searching right now, keyed by position and move. other threads
+// defer those moves to the end of their move loop and search the siblings first
+namespace
 {
-	1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3
-};
+	constexpr auto abdada_min_depth = 3;
+	constexpr auto abdada_size = 32768;
+	constexpr auto abdada_ways = 4;
+	std::atomic<uint64_t> abdada_table[abdada_size][abdada_ways];
 
-constexpr int th_skip_size1 [] =
-{
-	0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5
-};
+	uint64_t abdada_hash(const bit_board& board, const Move m)
+	{
+		return board.tt_key() ^ (static_cast<uint64_t>(m) + 1) * 0x9E3779B97F4A7C15ULL;
+	}
+
+	bool abdada_busy(const uint64_t hash)
+	{
+		for (auto& way : abdada_table[hash & abdada_size - 1])
+			if (way.load(std::memory_order_relaxed) == hash)
+				return true;
+		return false;
+	}
+
+	void abdada_start(const uint64_t hash)
+	{
+		auto& ways = abdada_table[hash & abdada_size - 1];
+		for (auto& way : ways)
+		{
+			const auto h = way.load(std::memory_order_relaxed);
+			if (h == hash)
+				return;
+			if (!h)
+			{
+				way.store(hash, std::memory_order_relaxed);
+				return;
+			}
+		}
+		ways[0].store(hash, std::memory_order_relaxed);
+	}
+
+	void abdada_finish(const uint64_t hash)
+	{
+		for (auto& way : abdada_table[hash & abdada_size - 1])
+			if (way.load(std::memory_order_relaxed) == hash)
+				way.store(0, std::memory_order_relaxed);
+	}
+}
 
 template <bool IsPv>
 int reduction(const bool improving, const int depth, const int move_count)
@@ -82,8 +121,8 @@ void Search::init_search()
 
 void Search::clear()
 {
-	tt.clear_table();
 	threads.main()->wait_for_search_stop();
+	tt.clear_table();
 	for (auto* th : threads)
 		th->clear();
 	threads.main()->previous_score = inf;
@@ -97,6 +136,8 @@ void MainThread::search()
 	draw_value[!color] = draw + contempt;
 	Time.init_time(color, num_moves, search_param);
 	tt.new_search();
+	calls_count = calls_interval = 0;
+	calls_total = 0;
 
 	for (auto* th : threads)
 	{
@@ -111,17 +152,34 @@ void MainThread::search()
 		if (th != this)
 			th->wait_for_search_stop();
 
+	if (threads.print_stats)
+		print_stats();
+
 	const thread* best_thread = this;
 
-	const auto m = best_thread->root_moves[0].pv[0];
-	const auto best_move = Uci::move_to_str(m);
-	std::cout << "bestmove " << best_move << std::endl;
+	if (threads.size() > 1 && !search_param.depth)
+	{
+		best_thread = threads.best_thread();
+		if (best_thread != this)
+			print(best_thread->root_moves[0].score, best_thread->completed_depth, best_thread->board);
+	}
+
+	best_move = best_thread->root_moves[0].pv[0];
 	previous_score = best_thread->root_moves[0].score;
+
+	// the other processes searched the rest of the root moves
+	if (cluster.active() && !cluster.is_worker())
+	{
+		cluster.stop_and_wait(!search_param.depth);
+		if (cluster.best_result(board, best_move, previous_score, best_thread->completed_depth))
+			sync_out << "info string cluster best " << Uci::move_to_str(best_move) << sync_endl;
+	}
+
+	sync_out << "bestmove " << Uci::move_to_str(best_move) << sync_endl;
 }
 
 void thread::search()
 {
-	const auto color = board.stm();
 	const auto* const main_thread = this == threads.main() ? threads.main() : nullptr;
 
 	search_stack stack[max_ply + 6], *ss = stack + 4;
@@ -130,42 +188,70 @@ void thread::search()
 	for (auto i = 4; i > 0; i--)
 		(ss - i)->piece_sq_history = this->piece_sq_history[no_piece].data();
 
-	Move best_move;
-	constexpr auto alpha = -inf, beta = inf;
-
 	while (root_depth < max_ply && !threads.stop
 		&& !(search_param.depth && main_thread && root_depth > search_param.depth))
 	{
-		if (thread_id)
+		if (thread_id && threads.depth_busy(root_depth))
 		{
-			if (const auto s = (thread_id - 1) % 12; (root_depth + num_moves + th_skip_size1[s] / th_skip_size0[s]) % 2)
-			{
-				++root_depth;
-				continue;
-			}
+			++root_depth;
+			continue;
 		}
 		for (auto& rm : root_moves)
 			rm.previous_score = rm.score;
 
+		threads.enter_depth(root_depth);
 		std::stable_sort(root_moves.begin(), root_moves.end());
-		const auto best_score = search_root(board, root_depth, alpha, beta, ss);
-		std::stable_sort(root_moves.begin(), root_moves.end());
+
+		// aspiration window around the last score of the best move, widened on every fail
+		auto alpha = -inf, beta = inf, delta = 0, best_score = -inf;
+		const auto previous = root_moves[0].previous_score;
+
+		if (root_depth >= 5 && previous > -inf)
+		{
+			delta = aspiration_delta;
+			alpha = std::max(previous - delta, -inf);
+			beta = std::min(previous + delta, inf);
+		}
+
+		while (true)
+		{
+			best_score = search_root(board, root_depth, alpha, beta, ss);
+			std::stable_sort(root_moves.begin(), root_moves.end());
+
+			if (threads.stop)
+				break;
+
+			if (main_thread && (best_score <= alpha || best_score >= beta) && Time.elapsed() > 3000)
+				print(best_score, root_depth, board, alpha, beta);
+
+			if (best_score <= alpha)
+			{
+				beta = (alpha + beta) / 2;
+				alpha = std::max(best_score - delta, -inf);
+			}
+			else if (best_score >= beta)
+				beta = std::min(best_score + delta, inf);
+			else
+				break;
+
+			delta += delta / 4 + 5;
+		}
+		threads.leave_depth(root_depth);
 
 		if (!threads.stop)
 		{
-			best_move = root_moves[0].pv[0];
 			completed_depth = root_depth;
 
-			if (!main_thread)
-				continue;
-
 			if (main_thread)
+			{
 				print(best_score, root_depth, board);
+				stats.iteration(root_depth, threads.nodes_searched());
 
-			if (search_param.use_time())
-			{
-				if (root_moves.size() == 1 || Time.elapsed() > Time.optimum())
-					threads.stop = true;
+				if (search_param.use_time())
+				{
+					if ((root_moves.size() == 1 && !cluster.active()) || Time.elapsed() > Time.optimum())
+						threads.stop = true;
+				}
 			}
 		}
 		else
@@ -176,8 +262,7 @@ void thread::search()
 	if (main_thread && search_param.depth)
 		threads.stop = true;
 
-	state_info st{};
-	board.make_move(best_move, st, color);
+	flush_nodes();
 }
 
 int Search::search_root(bit_board& board, const int depth, int alpha, const int beta, search_stack* ss)
@@ -192,7 +277,7 @@ int Search::search_root(bit_board& board, const int depth, int alpha, const int
 	auto* this_thread = board.this_thread();
 
 	if (this_thread == threads.main())
-		MainThread::check_time();
+		threads.main()->check_time();
 
 	ss->move_count = quiets_count = 0;
 	ss->stat_score = 0;
@@ -200,7 +285,8 @@ int Search::search_root(bit_board& board, const int depth, int alpha, const int
 	ss->current_move = move_none;
 	ss->piece_sq_history = this_thread->piece_sq_history[no_piece].data();
 	bool tt_hit;
-	auto* tt_entry = tt.probe(board.tt_key(), tt_hit);
+	tt_data tte;
+	auto* tt_entry = tt.probe(board.tt_key(), tt_hit, tte);
 	const auto tt_move = this_thread->root_moves[0].pv[0];
 	ss->ply = 1;
 	const auto color = board.stm();
@@ -221,6 +307,12 @@ int Search::search_root(bit_board& board, const int depth, int alpha, const int
 		{
 			continue;
 		}
+
+		// searchmoves, or the share of the root moves left to this process by the cluster
+		const auto rm_it = std::find(this_thread->root_moves.begin(), this_thread->root_moves.end(), new_move);
+		if (rm_it == this_thread->root_moves.end())
+			continue;
+
 		board.make_move(new_move, st, color);
 		ss->move_count = ++legal_moves;
 		ss->current_move = new_move;
@@ -248,7 +340,7 @@ int Search::search_root(bit_board& board, const int depth, int alpha, const int
 			quiets_count++;
 		}
 
-		auto& rm = *std::find(this_thread->root_moves.begin(), this_thread->root_moves.end(), new_move);
+		auto& rm = *rm_it;
 
 		if (score > best)
 		{
@@ -265,7 +357,7 @@ int Search::search_root(bit_board& board, const int depth, int alpha, const int
 
 		if (score > alpha)
 		{
-			if (score > beta)
+			if (score >= beta)
 			{
 				hash_flag = Beta;
 				alpha = beta;
@@ -276,7 +368,7 @@ int Search::search_root(bit_board& board, const int depth, int alpha, const int
 			hash_flag = exact;
 		}
 	}
-	tt_entry->save(board.tt_key(), depth, value_to_tt(alpha, ss->ply), best_move, hash_flag, tt.age());
+	tt_entry->save(board.tt_key(), depth, value_to_tt(alpha, ss->ply), value_none, best_move, hash_flag, tt.age());
 
 	if (alpha >= beta && !flag_in_check && !board.capture_or_promotion(best_move))
 	{
@@ -298,6 +390,7 @@ int razor_margin(const int depth)
 }
 
 int se_min_depth = 3;
+int se_tt_depth_margin = 3;
 int se_beta_min_margin = 100;
 int se_depth_factor = 120;
 
@@ -310,12 +403,28 @@ int nms_base_reduction = 3;
 int nms_depth_divisor = 6;
 int vs_max_depth = 12;
 
+int pc_min_depth = 5;
+int pc_margin = 200;
+int pc_improving_margin = 48;
+int pc_depth_reduction = 4;
+int pc_max_moves = 3;
+
 int iid_min_depth = 6;
 int iid_se_margin = 100;
 int iid_depth_factor = 3;
 int iid_depth_divisor = 4;
 int iid_depth_subtractant = 2;
 
+int lmp_max_depth = 16;
+int hp_max_depth = 3;
+int fpp_max_depth = 7;
+int fpp_base = 256;
+int fpp_factor = 200;
+int see_quiet_max_depth = 8;
+int see_quiet_factor = 35;
+int see_capture_max_depth = 7;
+int see_capture_factor = 200;
+
 int lmr_min_depth = 3;
 int lmr_move_count_min = 15;
 int lmr_stat_score_margin = 4000;
@@ -342,6 +451,7 @@ int alpha_beta(bit_board& board, int depth, int alpha, int beta, search_stack* s
 	if (threads.stop.load(std::memory_order_relaxed) || board.is_draw(ss->ply) || ss->ply >= max_ply)
 		return draw_value[color];
 
+	this_thread->stats.inc(stat_nodes);
 	state_info st{};
 	Move quiet_moves[64]{};
 
@@ -352,6 +462,7 @@ int alpha_beta(bit_board& board, int depth, int alpha, int beta, search_stack* s
 	ss->current_move = move_none;
 	ss->piece_sq_history = this_thread->piece_sq_history[no_piece].data();
 	(ss + 1)->semp = false;
+	(ss + 1)->excluded_move = move_none;
 	auto prev_sq = to_sq((ss - 1)->current_move);
 	alpha = std::max(mated_in(ss->ply), alpha);
 	beta = std::min(mate_in(ss->ply + 1), beta);
@@ -360,17 +471,29 @@ int alpha_beta(bit_board& board, int depth, int alpha, int beta, search_stack* s
 		return alpha;
 
 	hash_entry* tt_entry;
+	tt_data tte;
 	Move tt_move;
 	int tt_value;
+	auto tt_eval = value_none;
 	bool tt_hit;
-	tt_entry = tt.probe(board.tt_key(), tt_hit);
-	tt_move = tt_hit ? tt_entry->move() : move_none;
-	tt_value = tt_hit ? value_from_tt(tt_entry->eval(), ss->ply) : 0;
+	// the search without the excluded move gets its own tt entry
+	const auto excluded_move = ss->excluded_move;
+	const auto pos_key = excluded_move ? board.tt_key() ^ static_cast<uint64_t>(excluded_move) << 16 : board.tt_key();
+	tt_entry = tt.probe(pos_key, tt_hit, tte);
+	tt_move = tt_hit ? tte.move() : move_none;
+	tt_value = tt_hit ? value_from_tt(tte.eval(), ss->ply) : 0;
+	this_thread->stats.inc(stat_tt_probes);
+	if (tt_hit)
+		this_thread->stats.inc(stat_tt_hits);
+
+	// already searched at least this deep during this search, by this or another thread
+	if (tt_hit && tte.depth() >= depth && (tte.flag() & 0xFC) == tt.age())
+		++this_thread->dup_nodes;
 
 	if (!is_pv
 		&& tt_hit
-		&& tt_entry->depth() >= depth
-		&& (tt_value >= beta ? tt_entry->bound() == Beta : tt_entry->bound() == Alpha))
+		&& tte.depth() >= depth
+		&& (tt_value >= beta ? tte.bound() == Beta : tte.bound() == Alpha))
 	{
 		if (tt_move)
 		{
@@ -388,6 +511,8 @@ int alpha_beta(bit_board& board, int depth, int alpha, int beta, search_stack* s
 				update_piece_sq_history(ss, board.piece_on_sq(from_sq(tt_move)), to_sq(tt_move), penalty);
 			}
 		}
+		tt.record_cutoff();
+		this_thread->stats.inc(stat_tt_cutoffs);
 		return tt_value;
 	}
 
@@ -399,40 +524,64 @@ int alpha_beta(bit_board& board, int depth, int alpha, int beta, search_stack* s
 		goto moves_loop;
 	}
 
-	Evaluate eval;
-	ss->static_eval = (ss - 1)->current_move != move_null ? eval.evaluate(board) : -(ss - 1)->static_eval + 2 * tempo;
+	if ((ss - 1)->current_move == move_null)
+		ss->static_eval = -(ss - 1)->static_eval + 2 * tempo;
+	else if (tt_hit && tte.static_eval() != value_none)
+	{
+		ss->static_eval = tt_eval = tte.static_eval();
+		++this_thread->tt_evals;
+	}
+	else
+	{
+		constexpr Evaluate eval;
+		ss->static_eval = tt_eval = eval.evaluate(board);
+	}
 
 	if (ss->semp)
 		goto moves_loop;
 
 	// razoring
 	if (!is_pv
+		&& !excluded_move
 		&& depth < raz_max_depth
 		&& ss->static_eval + razor_margin(depth) <= alpha
 		&& !tt_move)
 	{
+		this_thread->stats.inc(stat_razor_tries);
 		if (depth <= 1 && ss->static_eval + razor_margin(depth) <= alpha)
+		{
+			this_thread->stats.inc(stat_razor_cuts);
 			return quiescent<non_pv, false>(board, alpha, beta, ss, 0);
+		}
 
 		auto raz_alpha = alpha - razor_margin(depth);
 
 		if (auto qvalue = quiescent<non_pv, false>(board, raz_alpha, raz_alpha + 1, ss, 0); qvalue <= raz_alpha)
+		{
+			this_thread->stats.inc(stat_razor_cuts);
 			return qvalue;
+		}
 	}
 
 	// futility pruning
 	if (depth < fp_max_depth
+		&& !excluded_move
 		&& ss->static_eval - fp_factor * depth >= beta
 		&& ss->static_eval < known_win
 		&& board.non_pawn_material(board.stm()))
+	{
+		this_thread->stats.inc(stat_futility_cuts);
 		return ss->static_eval;
+	}
 
 	// null move search
 	if (allow_null
 		&& !is_pv
+		&& !excluded_move
 		&& depth > nms_min_depth)
 	{
 		const auto R = nms_base_reduction + depth / nms_depth_divisor;
+		this_thread->stats.inc(stat_null_tries);
 		ss->current_move = move_null;
 		ss->piece_sq_history = this_thread->piece_sq_history[no_piece].data();
 		board.make_null_move(st);
@@ -449,35 +598,85 @@ int alpha_beta(bit_board& board, int depth, int alpha, int beta, search_stack* s
 			if (score >= mate_in_max_ply)
 				score = beta;
 			if (depth < vs_max_depth && abs(beta) < known_win)
+			{
+				this_thread->stats.inc(stat_null_cuts);
 				return score;
+			}
 			ss->semp = true;
 			auto value = depth - R < 1
 				? quiescent<non_pv, false>(board, beta - 1, beta, ss, 0)
 				: alpha_beta<non_pv>(board, depth - R, beta - 1, beta, ss, false);
 			ss->semp = false;
 			if (value >= beta)
+			{
+				this_thread->stats.inc(stat_null_cuts);
 				return score;
+			}
+		}
+	}
+
+	// probcut: a good capture that beats beta by a margin at reduced depth refutes the node
+	if (!is_pv
+		&& !excluded_move
+		&& depth >= pc_min_depth
+		&& abs(beta) < mate_in_max_ply)
+	{
+		const auto improving_eval = ss->static_eval >= (ss - 2)->static_eval;
+		const auto pc_beta = std::min(beta + pc_margin - pc_improving_margin * improving_eval, inf);
+		const check_info pc_ci(board);
+		move_picker pc_mp(board, tt_move, pc_beta - ss->static_eval);
+		auto pc_count = 0;
+		Move pc_move;
+		this_thread->stats.inc(stat_probcut_tries);
+
+		while ((pc_move = pc_mp.next_move()) != move_none && pc_count < pc_max_moves)
+		{
+			if (!board.is_legal(pc_move, pc_ci.pinned))
+				continue;
+
+			++pc_count;
+			ss->current_move = pc_move;
+			ss->piece_sq_history = &this_thread->piece_sq_history[board.moved_piece(pc_move)][to_sq(pc_move)];
+			board.make_move(pc_move, st, color);
+
+			// a quiescence search first to check the capture holds
+			auto value = st.checkers
+				? -quiescent<non_pv, true>(board, -pc_beta, -pc_beta + 1, ss + 1, 0)
+				: -quiescent<non_pv, false>(board, -pc_beta, -pc_beta + 1, ss + 1, 0);
+			if (value >= pc_beta)
+				value = -alpha_beta<non_pv>(board, depth - pc_depth_reduction, -pc_beta, -pc_beta + 1, ss + 1, true);
+			board.unmake_move(pc_move, color);
+
+			if (value >= pc_beta)
+			{
+				this_thread->stats.inc(stat_probcut_cuts);
+				return value;
+			}
 		}
+		ss->current_move = move_none;
+		ss->piece_sq_history = this_thread->piece_sq_history[no_piece].data();
 	}
 
 	// internal iterative deepening
 	if (depth >= iid_min_depth
 		&& !tt_move
+		&& !excluded_move
 		&& (is_pv || ss->static_eval + iid_se_margin >= beta))
 	{
 		auto d = iid_depth_factor * depth / iid_depth_divisor - iid_depth_subtractant;
 		ss->semp = true;
 		alpha_beta<Nt>(board, d, alpha, beta, ss, false);
 		ss->semp = false;
-		tt_entry = tt.probe(board.tt_key(), tt_hit);
-		tt_move = tt_hit ? tt_entry->move() : move_none;
+		tt_entry = tt.probe(pos_key, tt_hit, tte);
+		tt_move = tt_hit ? tte.move() : move_none;
+		tt_value = tt_hit ? value_from_tt(tte.eval(), ss->ply) : 0;
 	}
 
 moves_loop:
 
 	auto improving = ss->static_eval >= (ss - 2)->static_eval || ss->static_eval == 0 || (ss - 2)->static_eval == 0;
 	auto hash_flag = Alpha;
-	auto legal_moves = 0, best_score = -inf;
+	auto legal_moves = 0, pruned_moves = 0, best_score = -inf;
 	score = best_score;
 	bool tt_move_capture = false, do_full_depth_search;
 
@@ -491,25 +690,148 @@ moves_loop:
 	Move new_move, best_move = move_none;
 	move_picker mp(board, tt_move, depth, &this_thread->move_history, piece_hist, counter_move, ss->killers);
 
-	while ((new_move = mp.next_move()) != move_none)
+	// deferred moves are searched once the move picker is exhausted
+	const auto abdada = threads.abdada && depth >= abdada_min_depth && threads.size() > 1;
+	Move deferred_moves[64];
+	int deferred_move_counts[64];
+	auto deferred_count = 0, deferred_next = 0;
+	auto picker_done = false;
+
+	const auto next_move = [&]
 	{
-		if (!board.is_legal(new_move, ci.pinned))
+		if (!picker_done)
+		{
+			if (const auto m = mp.next_move(); m != move_none)
+				return m;
+			picker_done = true;
+		}
+		return deferred_next < deferred_count ? deferred_moves[deferred_next++] : move_none;
+	};
+
+	while ((new_move = next_move()) != move_none)
+	{
+		if (new_move == excluded_move || !board.is_legal(new_move, ci.pinned))
 		{
 			continue;
 		}
 
-		prefetch(tt.first_entry(board.next_key(new_move)));
+		const auto move_hash = abdada ? abdada_hash(board, new_move) : 0;
+
+		if (abdada && !picker_done && legal_moves && deferred_count < 64 && abdada_busy(move_hash))
+		{
+			deferred_move_counts[deferred_count] = legal_moves + pruned_moves + 1;
+			deferred_moves[deferred_count++] = new_move;
+			continue;
+		}
+
+		// singular extension: the tt move is extended when every other move fails low against a
+		// margin below its tt value. if they fail high against beta as well, the node is cut (multi-cut)
+		auto singular = false;
+
+		if (depth >= se_min_depth
+			&& new_move == tt_move
+			&& !excluded_move
+			&& tt_hit
+			&& (tte.bound() == Beta || tte.bound() == exact)
+			&& tte.depth() >= depth - se_tt_depth_margin
+			&& abs(tt_value) < known_win)
+		{
+			const auto singular_beta = tt_value - std::max(se_beta_min_margin, se_depth_factor * depth / 64);
+			ss->excluded_move = new_move;
+			const auto value = alpha_beta<non_pv>(board, depth / 2, singular_beta - 1, singular_beta, ss, false);
+			ss->excluded_move = move_none;
+			this_thread->stats.inc(stat_singular_tests);
+
+			if (value < singular_beta)
+			{
+				singular = true;
+				this_thread->stats.inc(stat_singular_extensions);
+			}
+			else if (singular_beta >= beta)
+			{
+				this_thread->stats.inc(stat_multi_cuts);
+				return singular_beta;
+			}
+		}
+
 		auto moved_piece = board.moved_piece(new_move);
 		capture_or_promotion = board.capture_or_promotion(new_move);
+
+		// shallow depth pruning, once a move has been searched without being mated
+		if (best_score > -mate_in_max_ply
+			&& board.non_pawn_material(color)
+			&& !board.gives_check(new_move, ci))
+		{
+			// a deferred move is pruned as it would have been at its place in the move order
+			const auto move_count = picker_done && deferred_next
+				? deferred_move_counts[deferred_next - 1]
+				: legal_moves + pruned_moves + 1;
+
+			if (!capture_or_promotion)
+			{
+				const auto lmr_depth = std::max(depth - 1 - reduction<Nt>(improving, depth, move_count), 0);
+				const auto to = to_sq(new_move);
+
+				// late move pruning
+				if (depth < lmp_max_depth && move_count >= futility_move_count[improving][depth])
+				{
+					this_thread->stats.inc(stat_lmp_prunes);
+					++pruned_moves;
+					continue;
+				}
+
+				// continuation history pruning
+				if (lmr_depth < hp_max_depth
+					&& (*piece_hist[0])[moved_piece][to] < counter_move_prune_threshold
+					&& (*piece_hist[1])[moved_piece][to] < counter_move_prune_threshold)
+				{
+					this_thread->stats.inc(stat_history_prunes);
+					++pruned_moves;
+					continue;
+				}
+
+				// futility pruning at the parent
+				if (lmr_depth < fpp_max_depth
+					&& !flag_in_check
+					&& ss->static_eval + fpp_base + fpp_factor * lmr_depth <= alpha)
+				{
+					this_thread->stats.inc(stat_futility_prunes);
+					++pruned_moves;
+					continue;
+				}
+
+				// quiets losing material
+				if (lmr_depth < see_quiet_max_depth
+					&& !board.see_ge(new_move, -see_quiet_factor * lmr_depth * lmr_depth))
+				{
+					this_thread->stats.inc(stat_see_prunes);
+					++pruned_moves;
+					continue;
+				}
+			}
+			else if (depth < see_capture_max_depth
+				&& !singular
+				&& !board.see_ge(new_move, -see_capture_factor * depth))
+			{
+				this_thread->stats.inc(stat_see_prunes);
+				++pruned_moves;
+				continue;
+			}
+		}
+
+		prefetch(tt.first_entry(board.next_key(new_move)));
 		tt_move_capture = tt_move && board.capture_or_promotion(tt_move);
 		board.make_move(new_move, st, color);
 		ss->move_count = ++legal_moves;
 		gives_check = st.checkers;
+
+		if (abdada)
+			abdada_start(move_hash);
 		ss->current_move = new_move;
 		ss->piece_sq_history = &this_thread->piece_sq_history[moved_piece][to_sq(new_move)];
 
-		// check extension
-		extension = gives_check ? 1 : 0;
+		// check and singular extensions
+		extension = gives_check || singular ? 1 : 0;
 		new_depth = depth - 1 + extension;
 
 		// reduced depth search (LMR)
@@ -525,7 +847,7 @@ moves_loop:
 			{
 				if ((ss - 1)->move_count > lmr_move_count_min)
 					depth_r -= 1;
-				if (tt_hit && tt_entry->bound() == exact)
+				if (tt_hit && tte.bound() == exact)
 					depth_r -= 1;
 				if (tt_move_capture)
 					depth_r += 1;
@@ -548,6 +870,9 @@ moves_loop:
 			auto d = std::max(new_depth - depth_r, 1);
 			score = -alpha_beta<non_pv>(board, d, -(alpha + 1), -alpha, ss + 1, true);
 			do_full_depth_search = score > alpha && d != new_depth;
+			this_thread->stats.inc(stat_lmr_searches);
+			if (do_full_depth_search)
+				this_thread->stats.inc(stat_lmr_researches);
 		}
 		else
 			do_full_depth_search = !is_pv || legal_moves > 1;
@@ -570,6 +895,8 @@ moves_loop:
 			Move pv[max_ply + 1];
 			(ss + 1)->pv = pv;
 			(ss + 1)->pv[0] = move_none;
+			if (legal_moves > 1)
+				this_thread->stats.inc(stat_pvs_researches);
 			score = new_depth < 1
 				? gives_check
 				? -quiescent<PV, true>(board, -beta, -alpha, ss + 1, 0)
@@ -583,6 +910,9 @@ moves_loop:
 		}
 		board.unmake_move(new_move, color);
 
+		if (abdada)
+			abdada_finish(move_hash);
+
 		if (threads.stop.load(std::memory_order_relaxed))
 			return 0;
 
@@ -596,6 +926,9 @@ moves_loop:
 					update_pv(ss->pv, best_move, (ss + 1)->pv);
 				if (score >= beta)
 				{
+					this_thread->stats.inc(stat_fail_highs);
+					if (legal_moves == 1)
+						this_thread->stats.inc(stat_first_move_fail_highs);
 					hash_flag = Beta;
 					alpha = beta;
 					break;
@@ -607,7 +940,7 @@ moves_loop:
 	}
 
 	if (!legal_moves)
-		alpha = flag_in_check ? mated_in(ss->ply) : draw_value[color];
+		alpha = excluded_move ? alpha : flag_in_check ? mated_in(ss->ply) : draw_value[color];
 	else if (best_move)
 	{
 		if (!board.capture_or_promotion(best_move))
@@ -618,7 +951,9 @@ moves_loop:
 	else if (depth >= 3 && !board.captured_piece() && is_ok((ss - 1)->current_move))
 		update_piece_sq_history(ss - 1, board.piece_on_sq(prev_sq), prev_sq, stat_bonus(depth));
 
-	tt_entry->save(board.tt_key(), depth, value_to_tt(alpha, ss->ply), best_move, hash_flag, tt.age());
+	tt_entry->save(pos_key, depth, value_to_tt(alpha, ss->ply), tt_eval, best_move, hash_flag, tt.age());
+	if (depth >= cluster_pool::share_depth && cluster.active() && !excluded_move)
+		cluster.share(pos_key, tt_entry);
 	return alpha;
 }
 
@@ -637,30 +972,45 @@ int quiescent(bit_board& board, int alpha, const int beta, search_stack* ss, con
 	if (board.is_draw(ss->ply) || ss->ply == max_ply)
 		return draw_value[color];
 
-	auto* tt_entry = tt.probe(board.tt_key(), tt_hit);
-	const auto tt_move = tt_hit ? tt_entry->move() : move_none;
-
-	if (const auto tt_value = tt_hit ? value_from_tt(tt_entry->eval(), ss->ply) : 0; tt_hit && tt_entry->depth() >= depth_qs
-		&& (is_pv ? tt_entry->bound() == exact : tt_value >= beta ? tt_entry->bound() == Beta : tt_entry->bound() == Alpha))
+	auto* this_thread = board.this_thread();
+	this_thread->stats.inc(stat_qs_nodes);
+	tt_data tte;
+	auto* tt_entry = tt.probe(board.tt_key(), tt_hit, tte);
+	const auto tt_move = tt_hit ? tte.move() : move_none;
+	this_thread->stats.inc(stat_tt_probes);
+	if (tt_hit)
+		this_thread->stats.inc(stat_tt_hits);
+
+	if (const auto tt_value = tt_hit ? value_from_tt(tte.eval(), ss->ply) : 0; tt_hit && tte.depth() >= depth_qs
+		&& (is_pv ? tte.bound() == exact : tt_value >= beta ? tte.bound() == Beta : tte.bound() == Alpha))
 	{
+		tt.record_cutoff();
+		this_thread->stats.inc(stat_tt_cutoffs);
 		return tt_value;
 	}
 
-	const auto* this_thread = board.this_thread();
 	if (InCheck)
 	{
 		ss->static_eval = 0;
-		standing_pat = INFINITE;
+		standing_pat = inf;
 	}
 	else
 	{
-		constexpr Evaluate eval;
-		standing_pat = eval.evaluate(board);
+		if (tt_hit && tte.static_eval() != value_none)
+		{
+			standing_pat = tte.static_eval();
+			++this_thread->tt_evals;
+		}
+		else
+		{
+			constexpr Evaluate eval;
+			standing_pat = eval.evaluate(board);
+		}
 
 		if (standing_pat >= beta)
 		{
 			if (tt_hit)
-				tt_entry->save(board.tt_key(), depth_qs, value_to_tt(standing_pat, ss->ply), move_none, Beta, tt.age());
+				tt_entry->save(board.tt_key(), depth_qs, value_to_tt(standing_pat, ss->ply), standing_pat, move_none, Beta, tt.age());
 			return standing_pat;
 		}
 
@@ -715,7 +1065,8 @@ int quiescent(bit_board& board, int alpha, const int beta, search_stack* ss, con
 		}
 	}
 
-	tt_entry->save(board.tt_key(), depth_qs, value_to_tt(alpha, ss->ply), best_move, hash_flag, tt.age());
+	tt_entry->save(board.tt_key(), depth_qs, value_to_tt(alpha, ss->ply), InCheck ? value_none : standing_pat, best_move, hash_flag,
+		tt.age());
 	return alpha;
 }
 
@@ -762,18 +1113,28 @@ inline int value_from_tt(const int val, const int ply)
 	return val == 0 ? 0 : val >= mate_in_max_ply ? val - ply : val <= mated_in_max_ply ? val + ply : val;
 }
 
+// the clock is read about once a millisecond: the poll interval follows the measured nodes per millisecond
 void MainThread::check_time()
 {
-	if (search_param.use_time() && Time.elapsed() > Time.maximum())
+	if (!search_param.use_time() || --calls_count > 0)
+		return;
+
+	// the interval is the rate of calls to this function so far, which unlike node_count leaves out qsearch
+	calls_total += calls_interval;
+	const auto elapsed = Time.elapsed();
+	calls_interval = calls_count = static_cast<int>(std::clamp<uint64_t>(calls_total / std::max(elapsed, 1L), 64, 16384));
+
+	if (elapsed > Time.maximum())
 		threads.stop = true;
 }
 
-void Search::print(const int best_score, const int depth, const bit_board& board)
+void Search::print(const int best_score, const int depth, const bit_board& board, const int alpha, const int beta)
 {
 	std::stringstream ss;
 	const auto& root_moves = board.this_thread()->root_moves;
 	const auto time = Time.get_time();
-	const auto nodes = static_cast<int>(threads.nodes_searched());
+	board.this_thread()->flush_nodes();
+	const auto nodes = static_cast<int>(threads.nodes_searched() + cluster.nodes());
 	auto nps = Time.get_nps(nodes);
 	if (nps < 0) nps = 0;
 
@@ -782,8 +1143,38 @@ void Search::print(const int best_score, const int depth, const bit_board& board
 		ss << "cp " << best_score;
 	else
 		ss << "mate " << (best_score > 0 ? mate - best_score + 1 : -mate - best_score) / 2;
+	ss << (best_score >= beta ? " lowerbound" : best_score <= alpha ? " upperbound" : "");
 	ss << " pv";
 	for (auto m : root_moves[0].pv)
 		ss << " " << Uci::move_to_str(m);
-	std::cout << ss.str() << std::endl;
+	sync_out << ss.str() << sync_endl;
+}
+
+void Search::print_stats()
+{
+	uint64_t probes = 0, hits = 0;
+	for (const auto* th : threads)
+	{
+		probes += th->eval_table.probes;
+		hits += th->eval_table.hits;
+	}
+
+	std::stringstream ss;
+	ss.precision(2);
+	ss << "info string evalcache " << threads.eval_cache_mb << " MB probes " << probes << " hits " << hits << " hitrate "
+		<< std::fixed << (probes ? 100.0 * static_cast<double>(hits) / static_cast<double>(probes) : 0.0) << "%";
+	sync_out << ss.str() << sync_endl;
+
+	// number of threads that searched each depth
+	ss.str(std::string());
+	ss << "info string occupancy";
+	for (auto d = 1; d < max_ply && threads.depth_searches[d]; ++d)
+		ss << " " << d << ":" << threads.depth_searches[d];
+	sync_out << ss.str() << sync_endl;
+
+	const auto nodes = threads.nodes_searched();
+	ss.str(std::string());
+	ss << "info string duplicate nodes " << threads.dup_nodes() << " of " << nodes << " ratio "
+		<< (nodes ? 100.0 * static_cast<double>(threads.dup_nodes()) / static_cast<double>(nodes) : 0.0) << "%";
+	sync_out << ss.str() << sync_endl;
 }
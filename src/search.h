@@ -15,6 +15,7 @@ namespace Search
 		Move* pv;
 		Move killers[2];
 		Move current_move;
+		Move excluded_move;
 
 		piece_history* piece_sq_history;
 
@@ -41,6 +42,7 @@ namespace Search
 		long time[Color]{};
 		int inc[Color]{}, depth, moves_to_go, infinite;
 		time_point start_time = 0;
+		std::vector<Move> search_moves;
 	};
 
 	extern search_params search_param;
@@ -74,7 +76,8 @@ namespace Search
 	int search_root(bit_board& board, int depth, int alpha, int beta, search_stack* ss);
 	void update_piece_sq_history(search_stack* ss, int piece, int to, int bonus);
 	void update_stats(const bit_board& board, Move move, search_stack* ss, const Move* quiet_moves, int q_count, int bonus);
-	void print(int best_score, int depth, const bit_board& board);
+	void print(int best_score, int depth, const bit_board& board, int alpha = -inf, int beta = inf);
+	void print_stats();
 }
 
 inline bool is_ok(const Move m)
@@ -0,0 +1,60 @@
+#include "stats.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	double percent(const uint64_t part, const uint64_t whole)
+	{
+		return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+	}
+}
+
+std::string search_stats::report() const
+{
+	std::ostringstream ss;
+
+	if constexpr (!search_stats_enabled)
+		ss << "search statistics are not compiled in, build with make stats=yes" << std::endl;
+	else
+	{
+		const auto& c = counters;
+		const auto all_nodes = c[stat_nodes] + c[stat_qs_nodes];
+		ss << std::fixed << std::setprecision(1);
+
+		ss << "nodes      : " << all_nodes << ", qsearch " << c[stat_qs_nodes] << " (" << percent(c[stat_qs_nodes], all_nodes) << "%)" << std::endl;
+		ss << "tt         : " << c[stat_tt_probes] << " probes, hits " << percent(c[stat_tt_hits], c[stat_tt_probes])
+			<< "%, cutoffs " << percent(c[stat_tt_cutoffs], c[stat_tt_probes]) << "%" << std::endl;
+		ss << "fail high  : " << c[stat_fail_highs] << ", first move " << percent(c[stat_first_move_fail_highs], c[stat_fail_highs]) << "%" << std::endl;
+		ss << "razoring   : " << c[stat_razor_tries] << " tries, cuts " << percent(c[stat_razor_cuts], c[stat_razor_tries]) << "%" << std::endl;
+		ss << "futility   : " << c[stat_futility_cuts] << " static cuts" << std::endl;
+		ss << "null move  : " << c[stat_null_tries] << " tries, cuts " << percent(c[stat_null_cuts], c[stat_null_tries]) << "%" << std::endl;
+		ss << "probcut    : " << c[stat_probcut_tries] << " tries, cuts " << percent(c[stat_probcut_cuts], c[stat_probcut_tries]) << "%" << std::endl;
+		ss << "singular   : " << c[stat_singular_tests] << " tests, " << c[stat_singular_extensions] << " extensions, "
+			<< c[stat_multi_cuts] << " multi cuts" << std::endl;
+		ss << "pruned     : lmp " << c[stat_lmp_prunes] << ", history " << c[stat_history_prunes] << ", futility "
+			<< c[stat_futility_prunes] << ", see " << c[stat_see_prunes] << std::endl;
+		ss << "lmr        : " << c[stat_lmr_searches] << " searches, re-searched " << percent(c[stat_lmr_researches], c[stat_lmr_searches]) << "%" << std::endl;
+		ss << "pvs        : " << c[stat_pvs_researches] << " re-searches" << std::endl;
+
+		// nodes spent on each iteration, and the growth over the one before it
+		uint64_t previous = 0;
+		ss << std::setprecision(2);
+
+		for (auto d = 1; d < max_ply; ++d)
+		{
+			const auto nodes = iteration_nodes[d];
+			if (!nodes)
+				continue;
+
+			ss << "depth " << std::setw(2) << d << "   : " << nodes << " nodes";
+			if (previous)
+				ss << ", ebf " << static_cast<double>(nodes) / static_cast<double>(previous);
+			ss << std::endl;
+			previous = nodes;
+		}
+	}
+
+	return ss.str();
+}
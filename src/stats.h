@@ -0,0 +1,83 @@
+#pragma once
+#include <string>
+
+#include "common.h"
+
+// search statistics, compiled in with make stats=yes (SEARCH_STATS). every counter is a plain per-thread
+// field bumped by the thread that owns it; compiled out, every update is discarded at compile time
+#ifdef SEARCH_STATS
+constexpr bool search_stats_enabled = true;
+#else
+constexpr bool search_stats_enabled = false;
+#endif
+
+enum search_stat
+{
+	stat_nodes,
+	stat_qs_nodes,
+	stat_tt_probes,
+	stat_tt_hits,
+	stat_tt_cutoffs,
+	stat_fail_highs,
+	stat_first_move_fail_highs,
+	stat_razor_tries,
+	stat_razor_cuts,
+	stat_futility_cuts,
+	stat_null_tries,
+	stat_null_cuts,
+	stat_probcut_tries,
+	stat_probcut_cuts,
+	stat_singular_tests,
+	stat_singular_extensions,
+	stat_multi_cuts,
+	stat_lmp_prunes,
+	stat_history_prunes,
+	stat_futility_prunes,
+	stat_see_prunes,
+	stat_lmr_searches,
+	stat_lmr_researches,
+	stat_pvs_researches,
+	stat_count
+};
+
+struct search_stats
+{
+	void inc(const search_stat s)
+	{
+		if constexpr (search_stats_enabled)
+			++counters[s];
+	}
+
+	// called by the main thread after every completed iteration, with the nodes of the whole pool so far
+	void iteration(const int depth, const uint64_t nodes)
+	{
+		if constexpr (search_stats_enabled)
+		{
+			iteration_nodes[depth] += nodes - searched_nodes;
+			searched_nodes = nodes;
+		}
+	}
+
+	void clear()
+	{
+		*this = {};
+	}
+
+	search_stats& operator+=(const search_stats& other)
+	{
+		if constexpr (search_stats_enabled)
+		{
+			for (auto i = 0; i < stat_count; ++i)
+				counters[i] += other.counters[i];
+			for (auto d = 0; d < max_ply; ++d)
+				iteration_nodes[d] += other.iteration_nodes[d];
+		}
+		return *this;
+	}
+
+	[[nodiscard]] std::string report() const;
+
+	uint64_t counters[search_stats_enabled ? stat_count : 1]{};
+	uint64_t iteration_nodes[search_stats_enabled ? max_ply : 1]{};
+	uint64_t searched_nodes = 0;
+};
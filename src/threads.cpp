@@ -1,9 +1,47 @@
 #include "threads.h"
 
+#include <algorithm>
+#include <map>
+
+#include "cluster.h"
 #include "movegen.h"
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 ThreadPool threads;
 
+namespace
+{
+#if defined(__linux__)
+	cpu_set_t process_cpus;
+#endif
+
+	// pins the calling thread to the n-th cpu of the process mask, or releases it when n is negative
+	void bind_to_cpu(const int n)
+	{
+#if defined(__linux__)
+		auto set = process_cpus;
+
+		if (n >= 0)
+		{
+			auto skip = n % std::max(CPU_COUNT(&process_cpus), 1);
+			CPU_ZERO(&set);
+
+			for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+				if (CPU_ISSET(cpu, &process_cpus) && !skip--)
+				{
+					CPU_SET(cpu, &set);
+					break;
+				}
+		}
+		pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+#endif
+	}
+}
+
 std::ostream& operator <<(std::ostream& os, const SyncOut sp)
 {
 	static Mutex m;
@@ -17,6 +55,7 @@ std::ostream& operator <<(std::ostream& os, const SyncOut sp)
 thread::thread(const size_t n) : std_thread_(&thread::idle_loop, this), thread_id(static_cast<int>(n))
 {
 	wait_for_search_stop();
+	eval_table.resize(threads.eval_cache_mb);
 	clear();
 }
 
@@ -29,6 +68,9 @@ thread::~thread()
 
 void ThreadPool::initialize()
 {
+#if defined(__linux__)
+	sched_getaffinity(0, sizeof process_cpus, &process_cpus);
+#endif
 	push_back(new MainThread(0));
 }
 
@@ -55,6 +97,13 @@ void thread::wait_for_search_stop()
 	cv_.wait(lock, [&] { return !searching_; });
 }
 
+void thread::execute(std::function<void()> job)
+{
+	wait_for_search_stop();
+	job_ = std::move(job);
+	start_searching();
+}
+
 void thread::idle_loop()
 {
 	while (true)
@@ -68,16 +117,84 @@ void thread::idle_loop()
 			return;
 
 		lock.unlock();
-		search();
+
+		if (job_)
+		{
+			job_();
+			job_ = nullptr;
+		}
+		else
+			search();
 	}
 }
 
 void ThreadPool::number_of_threads(const size_t n)
 {
-	while (size() < n)
-		push_back(new thread(size()));
+	main()->wait_for_search_stop();
+
 	while (size() > n && n > 0)
 		delete back(), pop_back();
+
+	// with Bind Threads a pool gets one cpu per thread, otherwise every thread is left to the scheduler,
+	// so that several engines on one machine do not all pile onto the first cpus
+	const auto pin = bind && n > 1;
+
+	for (auto* th : *this)
+	{
+		th->execute([pin, id = th->thread_id] { bind_to_cpu(pin ? id : -1); });
+		th->wait_for_search_stop();
+	}
+
+	while (size() < n)
+	{
+		// construct on the thread's cpu: the search thread inherits the binding and its tables are
+		// first touched, and so placed, on the node it runs on
+		thread* th = nullptr;
+		std::thread([&th, pin, id = size()]
+		{
+			bind_to_cpu(pin ? static_cast<int>(id) : -1);
+			th = new thread(id);
+		}).join();
+		push_back(th);
+	}
+}
+
+// every thread votes for its best move, weighted by score and completed depth; a proven mate wins outright
+thread* ThreadPool::best_thread() const
+{
+	std::map<Move, int64_t> votes;
+	auto* best = front();
+	auto min_score = inf;
+
+	for (const auto* th : *this)
+		min_score = std::min(min_score, th->root_moves[0].score);
+
+	for (const auto* th : *this)
+		votes[th->root_moves[0].pv[0]] += static_cast<int64_t>(th->root_moves[0].score - min_score + 14) * th->completed_depth;
+
+	for (auto* th : *this)
+	{
+		const auto best_score = best->root_moves[0].score;
+		const auto score = th->root_moves[0].score;
+
+		if (best_score >= mate_in_max_ply)
+		{
+			if (score > best_score)
+				best = th;
+		}
+		else if (score >= mate_in_max_ply
+			|| votes[th->root_moves[0].pv[0]] > votes[best->root_moves[0].pv[0]])
+			best = th;
+	}
+	return best;
+}
+
+void ThreadPool::eval_cache_size(const size_t mb_size)
+{
+	main()->wait_for_search_stop();
+	eval_cache_mb = mb_size;
+	for (auto* th : *this)
+		th->eval_table.resize(mb_size);
 }
 
 void ThreadPool::search_start(const bit_board& board, state_list& state, const Search::search_params& sp)
@@ -86,19 +203,29 @@ void ThreadPool::search_start(const bit_board& board, state_list& state, const S
 	stop = false;
 	Search::root_moves root_moves;
 	for (const auto m : move_list<legal>(board))
-		root_moves.emplace_back(m);
+		if (sp.search_moves.empty() || std::count(sp.search_moves.begin(), sp.search_moves.end(), m))
+			root_moves.emplace_back(m);
+	if (cluster.active() && !cluster.is_worker())
+		root_moves = cluster.search_start(root_moves, sp);
 	Search::search_param = sp;
 	if (state.get())
 		set_state_ = std::move(state);
 	const auto st = set_state_->back();
 	for (auto* th : threads)
 	{
-		th->nodes = 0;
+		th->nodes = th->node_count = 0;
+		th->completed_depth = 0;
+		th->tt_evals = 0;
+		th->dup_nodes = 0;
+		th->stats.clear();
+		th->eval_table.probes = th->eval_table.hits = 0;
 		th->board = board;
 		th->root_moves = root_moves;
 		th->root_depth = 1;
 		th->board.set_state(&set_state_->back(), th);
 	}
 	set_state_->back() = st;
+	for (auto d = 0; d < max_ply; ++d)
+		depth_threads[d] = depth_searches[d] = 0;
 	main()->start_searching();
 }
@@ -2,12 +2,15 @@
 #include <thread>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 
 #include "movepick.h"
 #include "search.h"
 #include "pawns.h"
 #include "material.h"
+#include "stats.h"
 
+#ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX
 #endif
@@ -42,6 +45,11 @@ struct Mutex
 private:
 	CRITICAL_SECTION cs_{};
 };
+#else
+#include <mutex>
+
+typedef std::mutex Mutex;
+#endif
 
 enum SyncOut
 {
@@ -57,12 +65,16 @@ std::ostream& operator <<(std::ostream&, SyncOut);
 
 typedef std::condition_variable_any ConditionVariable;
 
-class thread
+// the object is allocated and first touched by the thread that will run it, pinned to its cpu with Bind Threads (see
+// number_of_threads). members are grouped by who touches them, each group starting on its own cache line
+class alignas(cache_line_size) thread
 {
+	// start/stop handshake, touched by the thread that controls this one
 	Mutex mutex_;
 	ConditionVariable cv_;
 
 	bool exit_ = false, searching_ = true;
+	std::function<void()> job_;
 	std::thread std_thread_;
 
 public:
@@ -73,31 +85,59 @@ public:
 	void idle_loop();
 	void start_searching();
 	void wait_for_search_stop();
+	void execute(std::function<void()> job);
+
+	// make_move bumps a plain counter; other threads only see the copy published every 1024 nodes
+	void count_node()
+	{
+		if (!(++node_count & 1023))
+			flush_nodes();
+	}
+
+	void flush_nodes()
+	{
+		nodes.store(node_count, std::memory_order_relaxed);
+	}
 
 	int thread_id;
 
-	pawns::pawn_table pawn_table;
-	material::mat_table material_table;
+	// read by the main thread while this one searches
+	alignas(cache_line_size) std::atomic<uint64_t> nodes;
 
-	std::atomic<uint64_t> nodes;
+	// written by this thread only while it searches
+	alignas(cache_line_size) uint64_t node_count{};
+	uint64_t tt_evals{};
+	uint64_t dup_nodes{};
+	search_stats stats{};
+	int root_depth{};
 
 	bit_board board{};
-	counter_move_history counter_move_history{};
-	move_history move_history{};
-	piece_sq_history piece_sq_history{};
+	::counter_move_history counter_move_history{};
+	::move_history move_history{};
+	::piece_sq_history piece_sq_history{};
 
-	int root_depth{};
-	int completed_depth{};
+	pawns::pawn_table pawn_table;
+	material::mat_table material_table;
+	eval_hash_table eval_table;
+
+	// read by the main thread once the search has stopped
+	alignas(cache_line_size) int completed_depth{};
 	Search::root_moves root_moves;
 };
 
+static_assert(sizeof(thread) % cache_line_size == 0, "thread objects must not share a cache line");
+
 struct MainThread final :
 	thread
 {
 	using thread::thread;
 	void search() override;
-	static void check_time();
+	void check_time();
+	int calls_count{};
+	int calls_interval{};
+	uint64_t calls_total{};
 	int previous_score{};
+	Move best_move{};
 };
 
 struct ThreadPool :
@@ -105,7 +145,26 @@ struct ThreadPool :
 {
 	void initialize();
 	void number_of_threads(size_t);
+	void eval_cache_size(size_t mb_size);
 	void search_start(const bit_board& board, state_list& state, const Search::search_params& sp);
+	thread* best_thread() const;
+
+	// helpers skip a depth once half of the pool is already searching it
+	bool depth_busy(const int depth) const
+	{
+		return depth_threads[depth] >= std::max(static_cast<int>(size()) / 2, 1);
+	}
+
+	void enter_depth(const int depth)
+	{
+		++depth_threads[depth];
+		++depth_searches[depth];
+	}
+
+	void leave_depth(const int depth)
+	{
+		--depth_threads[depth];
+	}
 
 	MainThread* main() const
 	{
@@ -117,7 +176,38 @@ struct ThreadPool :
 		return accumulate_member(&thread::nodes);
 	}
 
-	std::atomic_bool stop;
+	uint64_t tt_evals() const
+	{
+		uint64_t sum = 0;
+		for (const auto* th : *this)
+			sum += th->tt_evals;
+		return sum;
+	}
+
+	uint64_t dup_nodes() const
+	{
+		uint64_t sum = 0;
+		for (const auto* th : *this)
+			sum += th->dup_nodes;
+		return sum;
+	}
+
+	search_stats stats() const
+	{
+		search_stats sum;
+		for (const auto* th : *this)
+			sum += th->stats;
+		return sum;
+	}
+
+	// read at every node by every thread
+	alignas(cache_line_size) std::atomic_bool stop;
+	alignas(cache_line_size) std::atomic<int> depth_threads[max_ply]{};
+	std::atomic<int> depth_searches[max_ply]{};
+	size_t eval_cache_mb = 1;
+	bool print_stats = false;
+	bool abdada = false;
+	bool bind = false;
 
 private:
 	state_list set_state_;
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "bitboard.h"
+#include "cluster.h"
 #include "hash.h"
 #include "movegen.h"
 #include "perft.h"
@@ -15,12 +16,43 @@ using namespace std;
 int num_moves = 0;
 bool is_white = true;
 const std::string startpos = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const time_point launch_time = now();
+time_point uciok_time = 0, readyok_time = 0;
+std::string hash_file;
+bool hash_file_pending = false;
+std::string cluster_address = "127.0.0.1";
 
 UCI::UCI()
 {
 	tt.resize(1024);
 }
 
+void allocate_hash()
+{
+	if (tt.allocate())
+		sync_out << "info string Hash " << tt.mb_size() << " MB, " << tt.page_mode_str() << sync_endl;
+}
+
+void save_hash(const bit_board& board, const std::string& file_name)
+{
+	threads.main()->wait_for_search_stop();
+
+	if (tt.save(file_name, zobrist_hash::signature()))
+		sync_out << "info string Hash saved to " << file_name << sync_endl;
+	else
+		sync_out << "info string Hash could not be saved to " << file_name << sync_endl;
+}
+
+void load_hash(const bit_board& board, const std::string& file_name)
+{
+	threads.main()->wait_for_search_stop();
+
+	if (tt.load(file_name, zobrist_hash::signature()))
+		sync_out << "info string Hash " << tt.mb_size() << " MB loaded from " << file_name << ", " << tt.page_mode_str() << sync_endl;
+	else
+		sync_out << "info string Hash file " << file_name << " is missing or does not match this engine" << sync_endl;
+}
+
 void UCI::loop(const int argc, char* argv[]) const
 {
 	std::string line;
@@ -28,7 +60,6 @@ void UCI::loop(const int argc, char* argv[]) const
 
 	slider_attacks.initialize();
 	bit_board board{};
-	board.zobrist.zobrist_fill();
 	board.init_board();
 	threads.initialize();
 	state_list state(new std::deque<state_info>(1));
@@ -42,7 +73,8 @@ void UCI::loop(const int argc, char* argv[]) const
 	do
 	{
 		// read cmd 'bench' if present, for automated external PGO compile
-		if (argc == 1 && !getline(std::cin, cmd))
+		// a cluster worker keeps reading, its stdin is the connection to the master
+		if ((argc == 1 || cluster.is_worker()) && !getline(std::cin, cmd))
 			cmd = "quit";
 		//cmd = trim(cmd);
 		if (cmd.empty())
@@ -59,12 +91,26 @@ void UCI::loop(const int argc, char* argv[]) const
 			sync_out << "id author " << author << sync_endl;
 			sync_out << "option name Hash type spin default 1024 min 1 max 1048576" << sync_endl;
 			sync_out << "option name Threads type spin default 1 min 1 max 128" << sync_endl;
+			sync_out << "option name Bind Threads type check default false" << sync_endl;
+			sync_out << "option name Large Pages type check default true" << sync_endl;
+			sync_out << "option name Eval Cache type spin default 1 min 0 max 256" << sync_endl;
+			sync_out << "option name Stats type check default false" << sync_endl;
+			sync_out << "option name ABDADA type check default false" << sync_endl;
 			sync_out << "option name Clear Hash type button" << sync_endl;
+			sync_out << "option name Hash File type string default <empty>" << sync_endl;
+			sync_out << "option name Cluster Address type string default 127.0.0.1" << sync_endl;
+			sync_out << "option name Cluster Port type spin default 0 min 0 max 65535" << sync_endl;
+			sync_out << "option name Perft Hash type spin default 0 min 0 max 65536" << sync_endl;
 			sync_out << "uciok" << sync_endl;
+			if (!uciok_time)
+				uciok_time = now() - launch_time;
 		}
 		else if (token == "isready")
 		{
+			allocate_hash();
 			sync_out << "readyok" << sync_endl;
+			if (!readyok_time)
+				readyok_time = now() - launch_time;
 		}
 		else if (token == "ucinewgame")
 		{
@@ -104,17 +150,115 @@ void UCI::loop(const int argc, char* argv[]) const
 		{
 			bench(board, state);
 		}
+		else if (token == "stats")
+		{
+			threads.main()->wait_for_search_stop();
+			sync_out << std::endl << threads.stats().report() << sync_endl;
+		}
+		else if (token == "ttbench")
+		{
+			auto depth = 12;
+			if (is >> token)
+				depth = stoi(token);
+			tt_bench(board, state, depth);
+		}
+		else if (token == "scaling")
+		{
+			auto n = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+			if (is >> token)
+				n = stoi(token);
+			scaling(board, state, n);
+		}
+		else if (token == "solve")
+		{
+			auto n = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+			auto ms = 3200;
+			if (is >> token)
+				n = stoi(token);
+			if (is >> token)
+				ms = stoi(token);
+			solve(board, state, n, ms);
+		}
+		else if (token == "solvedepth")
+		{
+			auto depth = 12;
+			if (is >> token)
+				depth = stoi(token);
+			solve_depth(board, state, depth);
+		}
+		else if (token == "smpbench")
+		{
+			auto n = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1U));
+			auto depth = 14;
+			if (is >> token)
+				n = stoi(token);
+			if (is >> token)
+				depth = stoi(token);
+			smp_bench(board, state, n, depth);
+		}
+		else if (token == "boardbench")
+		{
+			board_bench();
+		}
+		else if (token == "startup")
+		{
+			sync_out << "uciok  : " << uciok_time << " ms" << sync_endl;
+			sync_out << "readyok: " << readyok_time << " ms" << sync_endl;
+		}
+		else if (token == "savehash" || token == "loadhash")
+		{
+			const auto save = token == "savehash";
+			auto file_name = hash_file;
+			if (is >> token)
+				file_name = token;
+			if (file_name.empty())
+				sync_out << "info string no hash file given" << sync_endl;
+			else if (save)
+				save_hash(board, file_name);
+			else
+				load_hash(board, file_name);
+		}
+		else if (token == "cluster")
+		{
+			std::string host;
+			auto port = 0;
+			if (is >> token && token == "join" && is >> host >> port)
+			{
+				if (!cluster.join(host, port))
+					sync_out << "info string could not join cluster at " << host << ":" << port << sync_endl;
+			}
+			else
+				sync_out << "info string usage: cluster join <host> <port>" << sync_endl;
+		}
+		else if (token == "tt")
+		{
+			allocate_hash();
+			cluster.receive(is);
+		}
+		else if (token == "ttstress")
+		{
+			auto n = 4;
+			if (is >> token)
+				n = stoi(token);
+			transposition_table::stress_test(n);
+		}
 		else
 		{
 		}
-	} while (token != "quit" && argc == 1);
+	} while (token != "quit" && (argc == 1 || cluster.is_worker()));
+
+	threads.stop = true;
+	threads.main()->wait_for_search_stop();
+	cluster.close();
 }
 
 void UCI::update_position(bit_board& board, std::istringstream& input, state_list& state) const
 {
 	std::string token, fen;
+	const auto start = input.tellg();
 	input >> token;
 	state = std::make_unique<std::deque<state_info>>(1);
+	allocate_hash();
 
 	if (token == "startpos")
 	{
@@ -146,16 +290,19 @@ void UCI::update_position(bit_board& board, std::istringstream& input, state_lis
 			is_white = !is_white;
 		}
 	}
+
+	// cluster workers are sent the same position, whether it came from the gui or from bench and solve
+	if (start >= 0)
+		cluster.set_position("position " + input.str().substr(static_cast<size_t>(start)));
 }
 
 void UCI::new_game(bit_board& board, state_list& state) const
 {
 	state = std::make_unique<std::deque<state_info>>(1);
 	board.reset_board(nullptr, threads.main(), &state->back());
-	board.zobrist.get_zobrist_hash(board);
+	cluster.set_position("position startpos");
 	num_moves = 0;
 	is_white = true;
-	tt.clear_table();
 	Search::clear();
 }
 
@@ -171,15 +318,91 @@ void UCI::set_option(std::istringstream& input) const
 			if (token == "Hash")
 			{
 				input >> token;
+				if (token == "File")
+				{
+					input >> token;
+					getline(input >> std::ws, hash_file);
+					if (hash_file == "<empty>")
+						hash_file.clear();
+					hash_file_pending = !hash_file.empty();
+					break;
+				}
 				input >> token;
 				tt.resize(stoi(token));
 				break;
 			}
+			if (token == "Large")
+			{
+				input >> token;
+				input >> token;
+				input >> token;
+				tt.large_pages(token == "true");
+				break;
+			}
+			if (token == "Eval")
+			{
+				input >> token;
+				input >> token;
+				input >> token;
+				threads.eval_cache_size(stoi(token));
+				break;
+			}
+			if (token == "ABDADA")
+			{
+				input >> token;
+				input >> token;
+				threads.abdada = token == "true";
+				break;
+			}
+			if (token == "Stats")
+			{
+				input >> token;
+				input >> token;
+				threads.print_stats = token == "true";
+				break;
+			}
 			if (token == "Clear")
 			{
+				threads.main()->wait_for_search_stop();
 				tt.clear_table();
 				break;
 			}
+			if (token == "Perft")
+			{
+				input >> token;
+				input >> token;
+				input >> token;
+				perft_tt.resize(stoi(token));
+				break;
+			}
+			if (token == "Cluster")
+			{
+				input >> token;
+				if (token == "Address")
+				{
+					// the interface the next Cluster Port listens on, only loopback unless set otherwise
+					input >> token;
+					input >> cluster_address;
+					break;
+				}
+				input >> token;
+				input >> token;
+				const auto port = stoi(token);
+				if (port && cluster.listen(cluster_address, port))
+					sync_out << "info string cluster listening on " << cluster_address << ":" << port << sync_endl;
+				else if (port)
+					sync_out << "info string cluster could not listen on " << cluster_address << ":" << port << sync_endl;
+				break;
+			}
+			if (token == "Bind")
+			{
+				input >> token;
+				input >> token;
+				input >> token;
+				threads.bind = token == "true";
+				threads.number_of_threads(threads.size());
+				break;
+			}
 			if (token == "Threads")
 			{
 				input >> token;
@@ -196,6 +419,16 @@ void UCI::go(const bit_board& board, std::istringstream& input, state_list& stat
 	Search::search_params scs;
 	scs.start_time = now();
 	std::string token;
+	auto search_moves = false;
+	allocate_hash();
+
+	// the Hash File option is picked up by the first search, after any ucinewgame has cleared the table
+	if (hash_file_pending)
+	{
+		hash_file_pending = false;
+		load_hash(board, hash_file);
+		scs.start_time = now();
+	}
 
 	while (input >> token)
 	{
@@ -231,6 +464,14 @@ void UCI::go(const bit_board& board, std::istringstream& input, state_list& stat
 		}
 		else if (token == "infinite")
 			scs.infinite = 1;
+		else if (token == "searchmoves")
+			search_moves = true;
+		else if (search_moves)
+		{
+			const auto m = str_to_move(board, token);
+			if (m != move_none)
+				scs.search_moves.push_back(m);
+		}
 	}
 
 	threads.search_start(board, state, scs);
@@ -292,5 +533,6 @@ void UCI::perft(const bit_board& board, const bool is_divide, std::istringstream
 	input >> tk;
 	if (input)
 		depth = std::stoi(tk);
+	allocate_hash();
 	perft::perft_init(board, is_divide, depth);
 }
@@ -21,6 +21,14 @@ public:
 	void set_option(std::istringstream& input) const;
 	static void go(const bit_board& board, std::istringstream& input, state_list& state);
 	void bench(bit_board& board, state_list& state) const;
+	void tt_bench(bit_board& board, state_list& state, int depth) const;
+	void board_bench() const;
+	void solve(bit_board& board, state_list& state, int max_threads, int max_time) const;
+	int solve_suite(bit_board& board, state_list& state, int max_time, time_point& total) const;
+	void solve_depth(bit_board& board, state_list& state, int depth) const;
+	time_point time_to_depth(bit_board& board, state_list& state, int depth) const;
+	void smp_bench(bit_board& board, state_list& state, int thread_count, int depth) const;
+	void scaling(bit_board& board, state_list& state, int max_threads) const;
 	void perft(const bit_board& board, bool is_divide, std::istringstream& input) const;
 	static Move str_to_move(const bit_board& board, std::string& input);
 };
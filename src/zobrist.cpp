@@ -1,53 +1,35 @@
 #include "zobrist.h"
 
-#include <cmath>
 #include <iostream>
-#include <random>
 
 #include "bitboard.h"
 #include "bitops.h"
 
-std::random_device rd;
-std::mt19937_64 mt(rd());
-std::uniform_int_distribution<uint64_t> dist(std::llround(std::pow(2, 61)), std::llround(std::pow(2, 62)));
-
 uint64_t zobrist_hash::random64()
 {
-	const auto ran_ui = dist(mt);
-	return ran_ui;
+	static auto state = zobrist::seed;
+	return zobrist::next_key(state);
 }
 
-void zobrist_hash::zobrist_fill()
+// fingerprint of every key, stored with saved hash files so tables built from other keys are rejected
+uint64_t zobrist_hash::signature()
 {
-	for (auto& color : z_array)
-	{
-		for (auto piece_type = 0; piece_type <= king; piece_type++)
-		{
-			for (auto square = 0; square < 64; square++)
-			{
-				if (piece_type == 0)
-					color[piece_type][square] = 0LL;
-				else
-					color[piece_type][square] = random64();
-			}
-		}
-	}
+	uint64_t sig = 0;
+	const auto mix = [&sig](const uint64_t k) { sig = (sig ^ k) * 0x100000001B3ULL; };
 
-	for (auto& column : z_en_passant)
-	{
-		column = random64();
-	}
+	for (const auto& color : zobrist::zob_array)
+		for (const auto& piece : color)
+			for (const auto k : piece)
+				mix(k);
 
-	for (int i = no_castling; i <= any_castling; ++i)
-	{
-		z_castle[i] = random64();
-	}
-	z_black_move = random64();
-}
+	for (const auto k : zobrist::castling)
+		mix(k);
 
-void zobrist_hash::update_color()
-{
-	zobrist_key ^= z_black_move;
+	for (const auto k : zobrist::en_passant)
+		mix(k);
+
+	mix(zobrist::color);
+	return sig;
 }
 
 uint64_t zobrist_hash::get_zobrist_hash(const bit_board& bb_board)
@@ -61,7 +43,7 @@ uint64_t zobrist_hash::get_zobrist_hash(const bit_board& bb_board)
 		const auto square = pop_lsb(&pieces);
 		const auto piece = bb_board.piece_on_sq(square);
 
-		return_z_key ^= z_array[white][piece][square];
+		return_z_key ^= zobrist::zob_array[white][piece][square];
 	}
 
 	pieces = bb_board.pieces(black);
@@ -71,25 +53,23 @@ uint64_t zobrist_hash::get_zobrist_hash(const bit_board& bb_board)
 		const auto square = pop_lsb(&pieces);
 		const auto piece = bb_board.piece_on_sq(square);
 
-		return_z_key ^= z_array[black][piece][square];
+		return_z_key ^= zobrist::zob_array[black][piece][square];
 	}
 
 	if (bb_board.can_enpassant())
 	{
-		return_z_key ^= z_en_passant[file_of(bb_board.ep_square())];
+		return_z_key ^= zobrist::en_passant[file_of(bb_board.ep_square())];
 	}
 
 	if (bb_board.can_enpassant())
 	{
-		return_z_key ^= z_en_passant[file_of(bb_board.ep_square())];
+		return_z_key ^= zobrist::en_passant[file_of(bb_board.ep_square())];
 	}
 
-	return_z_key ^= z_castle[bb_board.castling_rights()];
+	return_z_key ^= zobrist::castling[bb_board.castling_rights()];
 
 	if (bb_board.stm() == black)
-		return_z_key ^= z_black_move;
-
-	zobrist_key = return_z_key;
+		return_z_key ^= zobrist::color;
 
 	return return_z_key;
 }
@@ -115,7 +95,7 @@ void zobrist_hash::test_distribution()
 	}
 }
 
-uint64_t zobrist_hash::debug_key(const bool is_white, const bit_board& bb_board) const
+uint64_t zobrist_hash::debug_key(const bool is_white, const bit_board& bb_board)
 {
 	uint64_t return_z_key = 0LL;
 
@@ -126,7 +106,7 @@ uint64_t zobrist_hash::debug_key(const bool is_white, const bit_board& bb_board)
 		const auto square = pop_lsb(&pieces);
 		const auto piece = bb_board.piece_on_sq(square);
 
-		return_z_key ^= z_array[white][piece][square];
+		return_z_key ^= zobrist::zob_array[white][piece][square];
 	}
 
 	pieces = bb_board.pieces(black);
@@ -136,25 +116,25 @@ uint64_t zobrist_hash::debug_key(const bool is_white, const bit_board& bb_board)
 		const auto square = pop_lsb(&pieces);
 		const auto piece = bb_board.piece_on_sq(square);
 
-		return_z_key ^= z_array[black][piece][square];
+		return_z_key ^= zobrist::zob_array[black][piece][square];
 	}
 
 	if (bb_board.can_enpassant())
 	{
-		return_z_key ^= z_en_passant[file_of(bb_board.ep_square())];
+		return_z_key ^= zobrist::en_passant[file_of(bb_board.ep_square())];
 	}
 
-	return_z_key ^= z_castle[bb_board.castling_rights()];
+	return_z_key ^= zobrist::castling[bb_board.castling_rights()];
 
 	if (is_white == false)
 	{
-		return_z_key ^= z_black_move;
+		return_z_key ^= zobrist::color;
 	}
 
 	return return_z_key;
 }
 
-uint64_t zobrist_hash::debug_pawn_key(const bit_board& bb_board) const
+uint64_t zobrist_hash::debug_pawn_key(const bit_board& bb_board)
 {
 	uint64_t p_key = 0LL;
 
@@ -162,18 +142,18 @@ uint64_t zobrist_hash::debug_pawn_key(const bit_board& bb_board) const
 	{
 		if ((bb_board.by_color_pieces_bb[white][pawn] >> s & 1) == 1)
 		{
-			p_key ^= z_array[white][pawn][s];
+			p_key ^= zobrist::zob_array[white][pawn][s];
 		}
 
 		if ((bb_board.by_color_pieces_bb[black][pawn] >> s & 1) == 1)
 		{
-			p_key ^= z_array[black][pawn][s];
+			p_key ^= zobrist::zob_array[black][pawn][s];
 		}
 	}
 	return p_key;
 }
 
-uint64_t zobrist_hash::debug_material_key(const bit_board& bb_board) const
+uint64_t zobrist_hash::debug_material_key(const bit_board& bb_board)
 {
 	uint64_t m_key = 0LL;
 
@@ -183,7 +163,7 @@ uint64_t zobrist_hash::debug_material_key(const bit_board& bb_board) const
 		{
 			for (auto count = 0; count <= bb_board.piece_count[color][pt]; ++count)
 			{
-				m_key ^= z_array[color][pt][count];
+				m_key ^= zobrist::zob_array[color][pt][count];
 			}
 		}
 	}
@@ -3,28 +3,63 @@
 
 class bit_board;
 
+namespace zobrist
+{
+	// splitmix64 with a fixed seed: the keys are the same in every build and on every machine
+	constexpr uint64_t seed = 0x52415A4552ULL;
+
+	constexpr uint64_t next_key(uint64_t& state)
+	{
+		auto k = state += 0x9E3779B97F4A7C15ULL;
+		k = (k ^ k >> 30) * 0xBF58476D1CE4E5B9ULL;
+		k = (k ^ k >> 27) * 0x94D049BB133111EBULL;
+		return k ^ k >> 31;
+	}
+
+	struct key_table
+	{
+		uint64_t pieces[Color][piece][sq_all];
+		uint64_t castling[castling_rights];
+		uint64_t en_passant[8];
+		uint64_t color;
+	};
+
+	constexpr key_table make_keys()
+	{
+		key_table keys{};
+		auto state = seed;
+
+		for (auto& c : keys.pieces)
+			for (auto pt = 1; pt < piece; ++pt)
+				for (auto& k : c[pt])
+					k = next_key(state);
+
+		for (auto& k : keys.en_passant)
+			k = next_key(state);
+
+		for (auto& k : keys.castling)
+			k = next_key(state);
+
+		keys.color = next_key(state);
+		return keys;
+	}
+
+	inline constexpr key_table keys = make_keys();
+	inline constexpr auto& zob_array = keys.pieces;
+	inline constexpr auto& en_passant = keys.en_passant;
+	inline constexpr auto& castling = keys.castling;
+	inline constexpr auto& color = keys.color;
+}
+
+// stateless helpers over the global key table
 class zobrist_hash
 {
 public:
-	uint64_t zobrist_key;
-	uint64_t z_array[2][7][64];
-	uint64_t z_castle[castling_rights];
-	uint64_t z_black_move;
-	uint64_t z_en_passant[8];
 	static uint64_t random64();
-	void zobrist_fill();
-	uint64_t get_zobrist_hash(const bit_board& bb_board);
-	void update_color();
+	static uint64_t get_zobrist_hash(const bit_board& bb_board);
+	static uint64_t signature();
 	static void test_distribution();
-	[[nodiscard]] uint64_t debug_key(bool is_white, const bit_board& bb_board) const;
-	[[nodiscard]] uint64_t debug_pawn_key(const bit_board& bb_board) const;
-	[[nodiscard]] uint64_t debug_material_key(const bit_board& bb_board) const;
+	[[nodiscard]] static uint64_t debug_key(bool is_white, const bit_board& bb_board);
+	[[nodiscard]] static uint64_t debug_pawn_key(const bit_board& bb_board);
+	[[nodiscard]] static uint64_t debug_material_key(const bit_board& bb_board);
 };
-
-namespace zobrist
-{
-	static uint64_t zob_array[Color][piece][sq_all];
-	static uint64_t en_passant[8];
-	static uint64_t castling[castling_rights];
-	static uint64_t color;
-}